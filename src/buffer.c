@@ -22,6 +22,9 @@
 #include <system.h>
 
 #include <signal.h>
+#if HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
 
 #include <alignalloc.h>
 #include <c-ctype.h>
@@ -84,6 +87,12 @@ static _Noreturn void write_fatal_details (char const *, ssize_t, idx_t);
 /* PID of child program, if compress_option or remote archive access.  */
 static pid_t child_pid;
 
+/* True if the compressed archive being written is split into frames.  */
+static bool compress_frames;
+
+/* Value of records_written at the start of the current frame.  */
+static off_t frame_start_record;
+
 /* Error recovery stuff  */
 static int read_error_count;
 
@@ -389,6 +398,67 @@ next_decompress_program (int *pstate)
   return zp ? zp->program : NULL;
 }
 
+/* Compression programs that decompress concatenated streams as a
+   whole, so that they can be restarted at any record boundary.  */
+static char const *const frame_program[] = {
+  GZIP_PROGRAM, BZIP2_PROGRAM, "lbzip2", LZIP_PROGRAM, XZ_PROGRAM,
+  ZSTD_PROGRAM
+};
+
+static bool
+frame_program_p (char const *program)
+{
+  for (int i = 0; i < countof (frame_program); i++)
+    if (streq (program, frame_program[i]))
+      return true;
+  return false;
+}
+
+/* Multi-threaded counterparts of the compression programs.  */
+struct parallel_program
+{
+  char const *program;		/* Compression program */
+  char const *parallel;		/* Program to run instead */
+  char const *option;		/* Its option setting the number of threads */
+  bool zero_ok;			/* True if OPTION accepts 0 as "all CPUs" */
+  bool decompress;		/* True if it decompresses in parallel, too */
+};
+
+static struct parallel_program const parallel_program[] = {
+  { GZIP_PROGRAM,  "pigz",       "-p ", false, true },
+  { BZIP2_PROGRAM, "lbzip2",     "-n ", false, true },
+  { "lbzip2",      "lbzip2",     "-n ", false, true },
+  { LZIP_PROGRAM,  "plzip",      "-n ", false, true },
+  { XZ_PROGRAM,    XZ_PROGRAM,   "-T",  true,  true },
+  { ZSTD_PROGRAM,  ZSTD_PROGRAM, "-T",  true,  false },
+};
+
+/* Return the command line that runs PROGRAM with the number of threads
+   requested by --compress-threads, or NULL if none was requested or
+   PROGRAM has no known multi-threaded counterpart.  If DECOMPRESS,
+   the command is going to be used for decompression.  Callers should
+   fall back to PROGRAM itself if the returned command cannot be
+   executed.  The returned string is allocated by xmalloc.  */
+char *
+parallel_compress_program (char const *program, bool decompress)
+{
+  if (compress_threads_option == 1)
+    return NULL;
+
+  for (struct parallel_program const *p = parallel_program;
+       p < parallel_program + countof (parallel_program); p++)
+    if (streq (program, p->program) && (p->decompress || !decompress))
+      {
+	/* Without the option, the programs that do not accept 0 use
+	   all available processors.  */
+	if (compress_threads_option == 0 && !p->zero_ok)
+	  return xstrdup (p->parallel);
+	return xasprintf ("%s %s%jd", p->parallel, p->option,
+			  compress_threads_option);
+      }
+  return NULL;
+}
+
 static const char *
 compress_option (enum compress_type type)
 {
@@ -481,7 +551,7 @@ open_compressed_archive (void)
                           check_compressed_archive */
 
       /* Open compressed archive */
-      child_pid = sys_child_open_for_uncompress ();
+      child_pid = sys_child_open_for_uncompress (0);
       read_full_records = true;
     }
 
@@ -580,10 +650,58 @@ static char const *const default_total_format[] = {
   N_("Total bytes deleted")
 };
 
+/* Print the totals and the performance statistics to stderr as a
+   single line holding a JSON object.  */
+static void
+print_total_stats_json (void)
+{
+  intmax_t bytes_read = 0, bytes_deleted = 0;
+  intmax_t total_written = prev_written + bytes_written;
+
+  switch (subcommand_option)
+    {
+    case DELETE_SUBCOMMAND:
+      bytes_read = records_read * record_size;
+      bytes_deleted = ((records_read - records_skipped) * record_size
+		       - total_written);
+      break;
+
+    case EXTRACT_SUBCOMMAND:
+    case LIST_SUBCOMMAND:
+    case DIFF_SUBCOMMAND:
+      bytes_read = records_read * record_size;
+      break;
+
+    default:
+      break;
+    }
+
+  fprintf (stderr,
+	   ("{\"subcommand\":\"%s\",\"bytes_read\":%jd,"
+	    "\"bytes_written\":%jd,\"bytes_deleted\":%jd,"),
+	   subcommand_string (subcommand_option),
+	   bytes_read, total_written, bytes_deleted);
+  format_stats_json (stderr);
+  fprintf (stderr, "}\n");
+}
+
 void
 print_total_stats (void)
 {
-  format_total_stats (stderr, default_total_format, '\n', '\n');
+  if (stats_format_option == STATS_FORMAT_JSON)
+    print_total_stats_json ();
+  else
+    format_total_stats (stderr, default_total_format, '\n', '\n');
+}
+
+/* Read up to SIZE bytes from the archive into BUF.  */
+static ptrdiff_t
+read_archive (void *buf, idx_t size)
+{
+  enum stats_phase phase = stats_enter (STATS_ARCHIVE_READ);
+  ptrdiff_t nread = rmtread (archive, buf, size);
+  stats_leave (phase);
+  return nread;
 }
 
 /* Compute and return the block ordinal at current_block.  */
@@ -681,6 +799,18 @@ check_tty (enum access_mode mode)
     }
 }
 
+/* Return true if the archive is a local regular file, or does not
+   exist yet.  The compression program then accesses it directly,
+   without an intervening tar process.  */
+bool
+archive_is_local_file (void)
+{
+  char const *name = archive_name_array[0];
+  struct stat st;
+  return (!streq (name, "-") && !_remdev (name)
+	  && (stat (name, &st) == 0 ? S_ISREG (st.st_mode) : errno == ENOENT));
+}
+
 /* Fetch the status of the archive, accessed via WANTED_STATUS.  */
 
 static void
@@ -752,13 +882,22 @@ _open_archive (enum access_mode wanted_access)
       switch (wanted_access)
         {
         case ACCESS_READ:
-          child_pid = sys_child_open_for_uncompress ();
+          child_pid = sys_child_open_for_uncompress (0);
           read_full_records = true;
           record_end = record_start; /* set up for 1st record = # 0 */
           break;
 
         case ACCESS_WRITE:
-          child_pid = sys_child_open_for_compress ();
+	  compress_frames = frame_size_option != 0;
+	  if (compress_frames
+	      && ! (frame_program_p (use_compress_program_option)
+		    && archive_is_local_file ()))
+	    {
+	      paxwarn (0, _("Cannot split this archive into compression frames"));
+	      compress_frames = false;
+	    }
+	  frame_start_record = 0;
+          child_pid = sys_child_open_for_compress (false);
           break;
 
         case ACCESS_UPDATE:
@@ -849,6 +988,21 @@ _open_archive (enum access_mode wanted_access)
 
   get_archive_status (wanted_access, backed_up_flag);
 
+  if (buffer_records_option && !use_compress_program_option
+      && wanted_access != ACCESS_UPDATE && !dev_null_output
+      && !streq (archive_name_array[0], "-") && !_isrmt (archive))
+    {
+      idx_t size;
+      if (ckd_mul (&size, buffer_records_option, record_size))
+	size = IDX_MAX;
+      child_pid = sys_child_open_for_io (wanted_access, size);
+      if (wanted_access == ACCESS_READ)
+	{
+	  read_full_records = true;
+	  seekable_archive = false;
+	}
+    }
+
   switch (wanted_access)
     {
     case ACCESS_READ:
@@ -977,7 +1131,7 @@ short_read (idx_t status)
       if (status)
 	{
 	  ptrdiff_t nread;
-	  while ((nread = rmtread (archive, more, left)) < 0)
+	  while ((nread = read_archive (more, left)) < 0)
 	    archive_read_error ();
 	  status = nread;
 	}
@@ -1004,6 +1158,19 @@ short_read (idx_t status)
   records_read++;
 }
 
+/* Finish the current compression frame and start a new one with the
+   record about to be written.  */
+static void
+new_compress_frame (void)
+{
+  if (rmtclose (archive) < 0)
+    close_error (*archive_name_cursor);
+  sys_wait_for_child (child_pid, false);
+  seek_index_add_frame (record_start_block);
+  child_pid = sys_child_open_for_compress (true);
+  frame_start_record = records_written;
+}
+
 /*  Flush the current buffer to/from the archive.  */
 void
 flush_archive (void)
@@ -1026,6 +1193,10 @@ flush_archive (void)
     }
 
   buffer_level = charptr (current_block) - charptr (record_start);
+  if (access_mode == ACCESS_WRITE && compress_frames
+      && (frame_size_option
+	  <= (records_written - frame_start_record) * record_size))
+    new_compress_frame ();
   record_start_block += record_end - record_start;
   current_block = record_start;
   record_end = record_start + blocking_factor;
@@ -1120,6 +1291,161 @@ seek_archive (off_t size)
   return nblk;
 }
 
+/* Copy the TOTAL bytes of whole records starting at byte IN of the
+   archive file to the seekable file FD, starting at its byte OUT.
+   Return the number of bytes copied, rounded down to whole records.
+   On file systems that support it, the copy shares the data blocks
+   instead of duplicating them.  */
+static off_t
+copy_records_to_file (int fd, off_t in, off_t out, off_t total)
+{
+  static bool unsupported;
+  off_t out_start = out;
+  off_t copied = 0;
+
+  if (unsupported)
+    return 0;
+
+  while (copied < total)
+    {
+      ssize_t n = copy_file_range (archive, &in, fd, &out,
+				   min (total - copied, SSIZE_MAX), 0);
+      if (n <= 0)
+	{
+	  if (n < 0 && copied == 0)
+	    unsupported = true;
+	  break;
+	}
+      copied += n;
+    }
+
+  /* Leave the rest of a partially copied record to the caller.  */
+  copied -= copied % record_size;
+  if (copied && lseek (fd, out_start + copied, SEEK_SET) < 0)
+    paxfatal (errno, _("Cannot reposition after copying archive data"));
+  return copied;
+}
+
+/* Send the TOTAL bytes of whole records starting at byte IN of the
+   archive file to FD, which is not seekable, e.g. a pipe.  Return the
+   number of bytes sent, rounded up to whole records, or down if the
+   rest of a record cannot be written.  */
+static off_t
+send_records (MAYBE_UNUSED int fd, MAYBE_UNUSED off_t in,
+	      MAYBE_UNUSED off_t total)
+{
+#if HAVE_SENDFILE
+  static bool unsupported;
+  off_t sent = 0;
+
+  if (unsupported)
+    return 0;
+
+  while (sent < total)
+    {
+      ssize_t n = sendfile (fd, archive, &in, min (total - sent, SSIZE_MAX));
+      if (n <= 0)
+	{
+	  if (n < 0 && sent == 0 && (errno == EINVAL || errno == ENOSYS))
+	    unsupported = true;
+	  break;
+	}
+      sent += n;
+    }
+
+  /* Data cannot be taken back from a pipe, so send the rest of a
+     partially sent record through the record buffer, which has been
+     used up.  If that fails, return only the whole records sent, so
+     that the caller writes the record itself and diagnoses the
+     error.  */
+  idx_t rest = sent % record_size;
+  if (rest)
+    {
+      idx_t need = record_size - rest;
+      if (pread (archive, record_start->buffer, need, in) != need)
+	read_fatal (*archive_name_cursor);
+      if (blocking_write (fd, record_start->buffer, need) == need)
+	sent += need;
+      else
+	sent -= rest;
+    }
+  return sent;
+#else
+  return 0;
+#endif
+}
+
+/* Copy as many whole records of the next SIZE bytes of the archive as
+   possible directly to the file FD, without going through the buffer,
+   and skip them in the archive.  Return the number of bytes copied,
+   which is zero unless the archive is an uncompressed local file
+   positioned at a record boundary.  */
+off_t
+copy_archive_records (int fd, off_t size)
+{
+  if (!seekable_archive || multi_volume_option || write_archive_to_stdout
+      || _isrmt (archive) || size < record_size
+      || current_block != record_start + blocking_factor
+      || record_end != current_block)
+    return 0;
+
+  off_t in = lseek (archive, 0, SEEK_CUR);
+  if (in < 0)
+    return 0;
+
+  off_t total = size - size % record_size;
+  off_t out = lseek (fd, 0, SEEK_CUR);
+  off_t copied = (0 <= out
+		  ? copy_records_to_file (fd, in, out, total)
+		  : send_records (fd, in, total));
+  if (copied && seek_archive (copied) != copied >> LG_BLOCKSIZE)
+    paxfatal (errno, _("Cannot reposition after copying archive data"));
+
+  /* seek_archive has counted the copied records in records_read;
+     run the checkpoints that flush_read would have run for them.  */
+  for (off_t n = copied / record_size; n; n--)
+    checkpoint_run (false);
+  return copied;
+}
+
+/* Return true if seek_archive_frame can be used on the archive being
+   read.  */
+bool
+frame_seekable_archive (void)
+{
+  return (archive_is_local_file ()
+	  && (use_compress_program_option ? child_pid != 0 : seekable_archive));
+}
+
+/* Restart reading the archive from the frame that starts at byte
+   OFFSET of the archive file and holds the blocks starting at block
+   number BLOCK.  A compressed archive is decompressed anew from
+   there.  OFFSET must be a multiple of the record size in an
+   uncompressed archive.  */
+void
+seek_archive_frame (off_t offset, off_t block)
+{
+  if (use_compress_program_option)
+    {
+      if (rmtclose (archive) < 0)
+	close_error (*archive_name_cursor);
+      sys_drop_child (child_pid);
+      child_pid = sys_child_open_for_uncompress (offset);
+    }
+  else
+    {
+      if (rmtlseek (archive, start_offset + offset, SEEK_SET) < 0)
+	{
+	  seek_error_details (*archive_name_cursor, offset);
+	  fatal_exit ();
+	}
+      records_read = offset / record_size;
+    }
+  hit_eof = false;
+  record_start_block = block;
+  current_block = record_end = record_start;
+}
+
 /* Close the archive file.  */
 void
 close_archive (void)
@@ -1439,7 +1765,7 @@ try_new_volume (void)
   if (!new_volume (acc))
     return true;
 
-  while ((status = rmtread (archive, charptr (record_start), record_size))
+  while ((status = read_archive (charptr (record_start), record_size))
          < 0)
     archive_read_error ();
 
@@ -1804,7 +2130,7 @@ simple_flush_read (void)
     }
 
   ptrdiff_t nread;
-  while ((nread = rmtread (archive, charptr (record_start), record_size)) < 0)
+  while ((nread = read_archive (charptr (record_start), record_size)) < 0)
     archive_read_error ();
   short_read_slop = 0;
   if (nread == record_size)
@@ -1851,7 +2177,7 @@ _gnu_flush_read (void)
     }
 
   ptrdiff_t nread;
-  while ((nread = rmtread (archive, charptr (record_start), record_size)) < 0
+  while ((nread = read_archive (charptr (record_start), record_size)) < 0
 	 && ! (errno == ENOSPC && multi_volume_option))
     archive_read_error ();
   /* The condition below used to include
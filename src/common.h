@@ -88,6 +88,7 @@ enum subcommand
   LIST_SUBCOMMAND,		/* -t */
   UPDATE_SUBCOMMAND,		/* -u */
   TEST_LABEL_SUBCOMMAND,        /* --test-label */
+  WATCH_CHANGES_SUBCOMMAND,     /* --watch-changes */
 };
 
 extern enum subcommand subcommand_option;
@@ -102,6 +103,10 @@ extern enum archive_format archive_format;
 extern idx_t blocking_factor;
 extern idx_t record_size;
 
+/* Number of records to buffer between tar and a separate process that
+   reads or writes the archive.  0 means access the archive directly.  */
+extern intmax_t buffer_records_option;
+
 extern bool absolute_names_option;
 
 /* Display file times in UTC */
@@ -136,9 +141,26 @@ enum { DEFAULT_CHECKPOINT = 10 };
 /* Specified name of compression program, or "gzip" as implied by -z.  */
 extern const char *use_compress_program_option;
 
+/* Number of threads to request from the compression program, or 0 to
+   let it use all available processors.  1 means to run the program as
+   is.  */
+extern intmax_t compress_threads_option;
+
+/* Split compressed archives being created into independently
+   decompressible frames of at least this many bytes.  0 means do not
+   split them.  */
+extern intmax_t frame_size_option;
+enum { DEFAULT_FRAME_SIZE = 16 * 1024 * 1024 };
+
 extern bool dereference_option;
 extern bool hard_dereference_option;
 
+/* Store files with the same contents only once.  */
+extern bool deduplicate_option;
+
+/* Store and check digests of file contents.  */
+extern bool digest_option;
+
 /* Patterns that match file names to be excluded.  */
 extern struct exclude *excluded;
 
@@ -162,6 +184,15 @@ extern gid_t group_option;
 
 extern bool ignore_failed_read_option;
 
+/* Number of directory entries to read ahead while creating an archive.  */
+extern intmax_t read_ahead_option;
+
+/* Number of worker processes that finish extracting regular files.  */
+extern intmax_t extract_workers_option;
+
+/* Number of worker processes that read ahead incremental scans.  */
+extern intmax_t scan_workers_option;
+
 extern bool ignore_zeros_option;
 
 extern bool incremental_option;
@@ -193,6 +224,9 @@ extern bool keep_directory_symlink_option;
 extern const char *listed_incremental_option;
 /* Incremental dump level: either -1, 0, or 1.  */
 extern signed char incremental_level;
+
+/* Change journal to record changes to, or to take them from.  */
+extern char const *change_journal_option;
 /* Check device numbers when doing incremental dumps. */
 extern bool check_device_option;
 
@@ -307,6 +341,15 @@ extern bool to_stdout_option;
 
 extern bool totals_option;
 
+/* Format of the totals, as given by --stats-format.  */
+enum stats_format
+  {
+    STATS_FORMAT_TEXT,
+    STATS_FORMAT_JSON
+  };
+
+extern enum stats_format stats_format_option;
+
 extern bool touch_option;
 
 extern char *to_command_option;
@@ -342,6 +385,9 @@ extern const char **archive_name_cursor;
 /* Output index file name.  */
 extern char const *index_file_name;
 
+/* Name of the index file for seeking in the archive, or NULL.  */
+extern char const *seek_index_option;
+
 /* Opaque structure for keeping directory meta-data */
 struct directory;
 
@@ -476,6 +522,10 @@ void clear_read_error_count (void);
 _Noreturn void archive_write_error (ssize_t status);
 void archive_read_error (void);
 off_t seek_archive (off_t size);
+off_t copy_archive_records (int fd, off_t size);
+bool archive_is_local_file (void);
+bool frame_seekable_archive (void);
+void seek_archive_frame (off_t offset, off_t block);
 void set_start_time (void);
 
 enum { TF_READ, TF_WRITE, TF_DELETED };
@@ -493,6 +543,7 @@ void buffer_write_global_xheader (void);
 
 const char *first_decompress_program (int *pstate);
 const char *next_decompress_program (int *pstate);
+char *parallel_compress_program (char const *program, bool decompress);
 
 /* Sum values returned by printf to estimate the total bytes output.
    Estimate -1 if there was a problem, e.g., int overflow or I/O error.  */
@@ -573,9 +624,14 @@ void delete_archive_members (void);
 
 /* Module incremen.c.  */
 
+bool start_scan_workers (void);
+void start_read_ahead_workers (void);
+void stop_scan_workers (void);
+void prefetch_files (int fd, char const *entries);
 struct directory *scan_directory (struct tar_stat_info *st);
 const char *directory_contents (struct directory *dir);
 const char *safe_directory_contents (struct directory *dir);
+bool directory_unread (struct directory const *dir);
 
 void rebase_directory (struct directory *dir,
 		       const char *samp, idx_t slen,
@@ -641,6 +697,7 @@ void read_and (void (*do_something) (void));
 enum read_header read_header (union block **return_block,
 			      struct tar_stat_info *info,
 			      enum read_header_mode m);
+int block_sum (union block const *block, int *high);
 enum read_header tar_checksum (union block *header, bool silent);
 void skim_file (off_t size, bool must_copy);
 void skip_member (void);
@@ -772,6 +829,8 @@ void undo_last_backup (void);
 int deref_stat (char const *name, struct stat *buf);
 
 idx_t blocking_read (int fd, void *buf, idx_t count);
+enum { READ_AHEAD_SIZE = 4 * 1024 * 1024 };
+void read_ahead (int fd, off_t size);
 idx_t blocking_write (int fd, void const *buf, idx_t count);
 
 /* Not valid as the first argument to openat.
@@ -785,6 +844,7 @@ struct chdir_id { int err; dev_t st_dev; ino_t st_ino; } chdir_id (void);
 struct fdbase fdbase (char const *);
 struct fdbase fdbase1 (char const *);
 void fdbase_clear (void);
+idx_t fdbase_known_prefix (char const *file_name);
 idx_t chdir_count (void);
 
 void close_diag (char const *name);
@@ -844,6 +904,7 @@ void blank_name_list (void);
 char *make_file_name (const char *dir_name, const char *name);
 ptrdiff_t stripped_prefix_len (char const *file_name, idx_t num);
 bool all_names_found (struct tar_stat_info *st);
+bool name_list_literal (void (*fun) (struct name const *));
 
 void add_avoided_name (char const *name);
 bool is_avoided_name (char const *name);
@@ -968,8 +1029,10 @@ bool sys_compare_uid (struct stat *a, struct stat *b);
 bool sys_compare_gid (struct stat *a, struct stat *b);
 bool sys_file_is_archive (struct tar_stat_info *p);
 int sys_truncate (int fd);
-pid_t sys_child_open_for_compress (void);
-pid_t sys_child_open_for_uncompress (void);
+pid_t sys_child_open_for_compress (bool append);
+pid_t sys_child_open_for_uncompress (off_t offset);
+void sys_drop_child (pid_t child_pid);
+pid_t sys_child_open_for_io (enum access_mode wanted_access, idx_t size);
 idx_t sys_write_archive_buffer (void);
 bool sys_get_archive_stat (void);
 int sys_exec_command (char *file_name, char typechar, struct tar_stat_info *st);
@@ -1055,14 +1118,15 @@ enum
     WARN_RECORD_SIZE		= 1 << 22,
     WARN_FAILED_READ		= 1 << 23,
     WARN_MISSING_ZERO_BLOCKS	= 1 << 24,
-    WARN_EMPTY_TRANSFORM        = 1 << 25
+    WARN_EMPTY_TRANSFORM        = 1 << 25,
+    WARN_COMPRESS_PROGRAM	= 1 << 26
   };
 /* These warnings are enabled by default in verbose mode: */
 enum
   {
     WARN_VERBOSE_WARNINGS = (WARN_RENAME_DIRECTORY | WARN_NEW_DIRECTORY
-			     | WARN_DECOMPRESS_PROGRAM | WARN_EXISTING_FILE
-			     | WARN_RECORD_SIZE),
+			     | WARN_COMPRESS_PROGRAM | WARN_DECOMPRESS_PROGRAM
+			     | WARN_EXISTING_FILE | WARN_RECORD_SIZE),
     WARN_ALL = ~0
   };
 
@@ -1093,9 +1157,59 @@ enum { EXCL_DEFAULT, EXCL_RECURSIVE, EXCL_NON_RECURSIVE };
 void excfile_add (const char *name, int flags);
 void info_attach_exclist (struct tar_stat_info *dir);
 void info_free_exclist (struct tar_stat_info *dir);
+void add_exclude_pattern (struct exclude *ex, char const *pattern,
+			  int options);
 bool excluded_name (char const *name, struct tar_stat_info *st);
 void exclude_vcs_ignores (void);
 
+/* Module journal.c */
+void change_journal_read (void);
+bool change_journal_unchanged (char const *caname);
+void watch_changes (void);
+
+/* Module seekidx.c */
+void seek_index_create (void);
+void seek_index_add_frame (off_t block);
+void seek_index_add_member (struct tar_stat_info const *st, off_t block);
+void seek_index_finish (void);
+bool seek_index_begin (void);
+bool seek_index_next (void);
+
+/* Module stats.c */
+enum stats_phase
+  {
+    STATS_OTHER,
+    STATS_DIRECTORY_SCAN,
+    STATS_STAT,
+    STATS_FILE_READ,
+    STATS_HEADER,
+    STATS_ARCHIVE_READ,
+    STATS_ARCHIVE_WRITE,
+    STATS_FILE_WRITE,
+    STATS_SET_STAT,
+    STATS_PHASES
+  };
+
+enum stats_phase stats_enter (enum stats_phase phase);
+void stats_leave (enum stats_phase prev);
+int stats_fstatat (int fd, char const *name, struct stat *st, int flags);
+void stats_member (char typeflag, off_t size);
+struct timespec stats_data_begin (void);
+void stats_data_end (struct timespec start, off_t size);
+void format_stats_json (FILE *fp);
+
+/* Module dedup.c */
+char const *dedup_find (struct tar_stat_info *st);
+void dedup_add (struct tar_stat_info const *st);
+bool same_file_contents (int fd1, int fd2, off_t size);
+
+/* Module digest.c */
+enum { DIGEST_HEX_SIZE = 2 * 32 + 1 };
+bool file_digest (int fd, off_t size, char digest[DIGEST_HEX_SIZE]);
+void digest_begin (void);
+void digest_update (void const *buf, idx_t size);
+void digest_end (char digest[DIGEST_HEX_SIZE]);
+
 /* Module map.c */
 void owner_map_read (char const *name);
 void owner_map_translate (uid_t uid, uid_t *new_uid, char const **new_name);
@@ -178,6 +178,26 @@ diff_dir (void)
     report_difference (&current_stat_info, _("Mode differs"));
 }
 
+/* Compare the file open as DIFF_HANDLE with the digest of the current
+   member, and skip the member data instead of reading it.  This is
+   not done when verifying, whose purpose is to read back the data
+   just written.  */
+static void
+diff_digest (void)
+{
+  char digest[DIGEST_HEX_SIZE];
+
+  skip_member ();
+  if (!file_digest (diff_handle, current_stat_info.stat.st_size, digest))
+    {
+      if (errno)
+	read_error (current_stat_info.file_name);
+      report_difference (&current_stat_info, NULL);
+    }
+  else if (!streq (digest, current_stat_info.digest))
+    report_difference (&current_stat_info, _("Contents differ"));
+}
+
 static void
 diff_file (void)
 {
@@ -227,6 +247,9 @@ diff_file (void)
 	    {
 	      if (current_stat_info.is_sparse)
 		sparse_diff_file (diff_handle, &current_stat_info);
+	      else if (digest_option && current_stat_info.digest
+		       && !now_verifying)
+		diff_digest ();
 	      else
 		read_and_process (&current_stat_info, process_rawdata);
 
@@ -245,6 +268,45 @@ diff_file (void)
     }
 }
 
+/* Compare the file FILE_DATA, which is a duplicate of LINK_DATA, with
+   it.  A duplicate need not be linked to the file it duplicates, but
+   must have the same contents.  */
+static void
+diff_duplicate (struct stat const *file_data, struct stat const *link_data)
+{
+  char const *file_name = current_stat_info.file_name;
+  char const *link_name = current_stat_info.link_name;
+
+  if (file_data->st_size != link_data->st_size)
+    {
+      report_difference (&current_stat_info, _("Size differs"));
+      return;
+    }
+
+  struct fdbase f = fdbase (file_name);
+  int fd = f.fd == BADFD ? -1 : openat (f.fd, f.base, open_read_flags);
+  if (fd < 0)
+    {
+      open_error (file_name);
+      report_difference (&current_stat_info, NULL);
+      return;
+    }
+  struct fdbase f1 = fdbase1 (link_name);
+  int fd1 = f1.fd == BADFD ? -1 : openat (f1.fd, f1.base, open_read_flags);
+  if (fd1 < 0)
+    {
+      open_error (link_name);
+      report_difference (&current_stat_info, NULL);
+    }
+  else
+    {
+      if (!same_file_contents (fd, fd1, file_data->st_size))
+	report_difference (&current_stat_info, _("Contents differ"));
+      close (fd1);
+    }
+  close (fd);
+}
+
 static void
 diff_link (void)
 {
@@ -254,10 +316,15 @@ diff_link (void)
   if (get_stat_data (current_stat_info.file_name, &file_data)
       && get_stat_data (current_stat_info.link_name, &link_data)
       && !psame_inode (&file_data, &link_data))
-    report_difference (&current_stat_info,
-		       _("Not linked to %s"),
-		       quote_n_colon (QUOTE_ARG,
-				      current_stat_info.link_name));
+    {
+      if (current_stat_info.is_duplicate)
+	diff_duplicate (&file_data, &link_data);
+      else
+	report_difference (&current_stat_info,
+			   _("Not linked to %s"),
+			   quote_n_colon (QUOTE_ARG,
+					  current_stat_info.link_name));
+    }
 }
 
 static void
@@ -708,11 +708,8 @@ write_header_name (struct tar_stat_info *st)
 
 /* Header handling.  */
 
-/* Make a header block for the file whose stat info is st,
-   and return its address.  */
-
-union block *
-start_header (struct tar_stat_info *st)
+static union block *
+start_header0 (struct tar_stat_info *st)
 {
   union block *header;
   char const *uname = NULL;
@@ -955,11 +952,7 @@ simple_finish_header (union block *header)
   /* Fill checksum field with spaces while the checksum is computed.  */
   memset (header->header.chksum, ' ', sizeof header->header.chksum);
 
-  int sum = 0;
-  char *p = header->buffer;
-  for (int i = sizeof *header; i-- != 0; )
-    /* We can't use unsigned char here because of old compilers, e.g. V7.  */
-    sum += 0xFF & *p++;
+  int sum = block_sum (header, NULL);
 
   /* Fill in the checksum field.  It's formatted differently from the
      other fields: it has [6] digits, a null, then a space -- rather than
@@ -977,6 +970,18 @@ simple_finish_header (union block *header)
   set_next_block_after (header);
 }
 
+/* Make a header block for the file whose stat info is st,
+   and return its address.  */
+
+union block *
+start_header (struct tar_stat_info *st)
+{
+  enum stats_phase phase = stats_enter (STATS_HEADER);
+  union block *header = start_header0 (st);
+  stats_leave (phase);
+  return header;
+}
+
 /* Finish off a filled-in header block and write it out.  We also
    print the file name and/or full info if verbose is on.  If BLOCK_ORDINAL
    is not negative, is the block ordinal of the first record for this
@@ -985,21 +990,30 @@ void
 finish_header (struct tar_stat_info *st,
 	       union block *header, off_t block_ordinal)
 {
+  enum stats_phase phase = stats_enter (STATS_HEADER);
+  bool member = (header->header.typeflag != GNUTYPE_LONGLINK
+		 && header->header.typeflag != GNUTYPE_LONGNAME
+		 && header->header.typeflag != XHDTYPE
+		 && header->header.typeflag != XGLTYPE);
+
   /* Note: It is important to do this before the call to write_extended(),
      so that the actual ustar header is printed */
-  if (verbose_option
-      && header->header.typeflag != GNUTYPE_LONGLINK
-      && header->header.typeflag != GNUTYPE_LONGNAME
-      && header->header.typeflag != XHDTYPE
-      && header->header.typeflag != XGLTYPE)
+  if (verbose_option && member)
     {
       /* FIXME: This global is used in print_header, sigh.  */
       current_format = archive_format;
       print_header (st, header, block_ordinal);
     }
 
+  if (member)
+    stats_member (header->header.typeflag, st->stat.st_size);
+
+  if (block_ordinal >= 0)
+    seek_index_add_member (st, block_ordinal);
+
   header = write_extended (false, st, header);
   simple_finish_header (header);
+  stats_leave (phase);
 }
 
 
@@ -1023,6 +1037,15 @@ dump_regular_file (int fd, struct tar_stat_info *st)
   off_t block_ordinal;
   union block *blk;
 
+  /* The digest goes into the extended header, which precedes the
+     data, so the file is read for it first.  */
+  if (digest_option && 0 < fd)
+    {
+      char digest[DIGEST_HEX_SIZE];
+      if (file_digest (fd, size_left, digest))
+	assign_string (&st->digest, digest);
+    }
+
   block_ordinal = current_block_ordinal ();
   blk = start_header (st);
   if (!blk)
@@ -1032,9 +1055,21 @@ dump_regular_file (int fd, struct tar_stat_info *st)
   if (archive_format != V7_FORMAT && S_ISCTG (st->stat.st_mode))
     blk->header.typeflag = CONTTYPE;
 
+  if (st->digest)
+    xheader_store ("GNU.digest.sha256", st, NULL);
+
   finish_header (st, blk, block_ordinal);
 
+  /* Check that the data archived is the data the digest was computed
+     from.  */
+  bool check_digest = st->digest && 0 < fd;
+  if (check_digest)
+    digest_begin ();
+
   mv_begin_write (st->file_name, st->stat.st_size, st->stat.st_size);
+  if (0 < fd)
+    read_ahead (fd, size_left);
+  struct timespec data_start = stats_data_begin ();
   while (size_left > 0)
     {
       blk = find_next_block ();
@@ -1050,8 +1085,17 @@ dump_regular_file (int fd, struct tar_stat_info *st)
 	    memset (blk->buffer + size_left, 0, BLOCKSIZE - beyond);
 	}
 
-      idx_t count = (fd <= 0 ? bufsize
-		     : blocking_read (fd, charptr (blk), bufsize));
+      idx_t count;
+      if (fd <= 0)
+	count = bufsize;
+      else
+	{
+	  enum stats_phase phase = stats_enter (STATS_FILE_READ);
+	  count = blocking_read (fd, charptr (blk), bufsize);
+	  stats_leave (phase);
+	  if (check_digest)
+	    digest_update (charptr (blk), count);
+	}
       size_left -= count;
       set_next_block_after (charptr (blk) + bufsize - 1);
 
@@ -1075,10 +1119,65 @@ dump_regular_file (int fd, struct tar_stat_info *st)
 	  return dump_status_short;
 	}
     }
+  stats_data_end (data_start, st->stat.st_size);
+
+  if (check_digest)
+    {
+      char digest[DIGEST_HEX_SIZE];
+      digest_end (digest);
+      if (!streq (digest, st->digest))
+	{
+	  warnopt (WARN_FILE_CHANGED, 0,
+		   _("%s: file changed as we read it; stored digest is wrong"),
+		   quotearg_colon (st->orig_file_name));
+	  set_exit_status (TAREXIT_DIFFERS);
+	}
+    }
   return dump_status_ok;
 }
 
 
+/* Have the read-ahead workers start reading up to COUNT of the
+   entries starting at AHEAD, in the format returned by
+   get_directory_entries, of the directory ST.  Skip excluded entries.
+   Return the entry after the last one considered.  */
+static char const *
+read_ahead_entries (struct tar_stat_info *st, char const *ahead,
+		    intmax_t count)
+{
+  static char *batch;
+  static idx_t batch_size;
+  static char *name_buf;
+  static idx_t name_size;
+  idx_t batch_len = 0;
+  idx_t dir_len = strlen (st->orig_file_name);
+
+  for (; 0 < count && *ahead; count--)
+    {
+      idx_t len = strlen (ahead);
+      if (name_size <= dir_len + len)
+	name_buf = xpalloc (name_buf, &name_size,
+			    dir_len + len + 1 - name_size, -1, 1);
+      strcpy (stpcpy (name_buf, st->orig_file_name), ahead);
+      if (!excluded_name (name_buf, st))
+	{
+	  if (batch_size <= batch_len + len + 1)
+	    batch = xpalloc (batch, &batch_size,
+			     batch_len + len + 2 - batch_size, -1, 1);
+	  memcpy (batch + batch_len, ahead, len + 1);
+	  batch_len += len + 1;
+	}
+      ahead += len + 1;
+    }
+
+  if (batch_len)
+    {
+      batch[batch_len] = '\0';
+      prefetch_files (st->fd, batch);
+    }
+  return ahead;
+}
+
 /* Copy info from the directory identified by ST into the archive.
    DIRECTORY contains the directory's entries.  */
 
@@ -1175,12 +1274,30 @@ dump_dir0 (struct tar_stat_info *st, char const *directory)
 	    name_buf = xstrdup (st->orig_file_name);
 	    idx_t name_len = name_size = strlen (name_buf);
 
-	    /* Now output all the files in the directory.  */
+	    /* Now output all the files in the directory.  Keep the
+	       read_ahead_option entries after ENTRY read ahead, asking
+	       for more when half of them have been archived.  */
 	    idx_t entry_len;
+	    char const *ahead = directory;
+	    intmax_t ahead_count = 0;
 	    for (char const *entry = directory;
 		 (entry_len = strlen (entry)) != 0;
 		 entry += entry_len + 1)
 	      {
+		if (ahead == entry)
+		  ahead += entry_len + 1;
+		else
+		  ahead_count--;
+		if (read_ahead_option && ahead_count <= read_ahead_option / 2
+		    && *ahead)
+		  {
+		    char const *p = ahead;
+		    ahead = read_ahead_entries (st, ahead,
+						read_ahead_option - ahead_count);
+		    for (; p < ahead; p += strlen (p) + 1)
+		      ahead_count++;
+		  }
+
 		if (name_size < name_len + entry_len)
 		  {
 		    name_size = name_len + entry_len;
@@ -1266,7 +1383,10 @@ get_directory_entries (struct tar_stat_info *st)
   while (! (st->dirstream = fdopendir (st->fd)))
     if (! open_failure_recover (st))
       return NULL;
-  return streamsavedir (st->dirstream, savedir_sort_order);
+  enum stats_phase phase = stats_enter (STATS_DIRECTORY_SCAN);
+  char *entries = streamsavedir (st->dirstream, savedir_sort_order);
+  stats_leave (phase);
+  return entries;
 }
 
 /* Dump the directory ST.  Return true if successful, false (emitting
@@ -1275,6 +1395,16 @@ get_directory_entries (struct tar_stat_info *st)
 static bool
 dump_dir (struct tar_stat_info *st)
 {
+  /* An incremental dump takes the entries from the directory table, so
+     do not read them again if the scan could do without.  */
+  if (incremental_option && gnu_list_name->directory
+      && directory_unread (gnu_list_name->directory))
+    {
+      dump_dir0 (st, NULL);
+      restore_parent_fd (st);
+      return true;
+    }
+
   char *directory = get_directory_entries (st);
   if (! directory)
     {
@@ -1306,7 +1436,9 @@ create_archive (void)
   trivial_link_count = filename_args != FILES_MANY && ! dereference_option;
 
   open_archive (ACCESS_WRITE);
+  seek_index_create ();
   buffer_write_global_xheader ();
+  start_read_ahead_workers ();
 
   if (incremental_option)
     {
@@ -1381,8 +1513,10 @@ create_archive (void)
 	  dump_file (NULL, name, name);
     }
 
+  stop_scan_workers ();
   write_eot ();
   close_archive ();
+  seek_index_finish ();
   finish_deferred_unlinks ();
   if (listed_incremental_option)
     write_directory_file ();
@@ -1424,6 +1558,36 @@ unknown_file_error (char const *p)
    again if we've done it once already.  */
 static Hash_table *link_table;
 
+/* Dump ST as a link to the member LINK_NAME.  If DUPLICATE, ST is
+   not the same file as LINK_NAME, but has the same contents.  Return
+   true if successful.  */
+static bool
+dump_link_member (struct tar_stat_info *st, char const *link_name,
+		  bool duplicate)
+{
+  off_t block_ordinal = current_block_ordinal ();
+  assign_string (&st->link_name, link_name);
+  if (NAME_FIELD_SIZE - (archive_format == OLDGNU_FORMAT)
+      < strlen (link_name))
+    write_long_link (st);
+
+  st->stat.st_size = 0;
+  union block *blk = start_header (st);
+  if (!blk)
+    return false;
+  tar_copy_str (blk->header.linkname, link_name, NAME_FIELD_SIZE);
+  if (duplicate)
+    xheader_store ("GNU.duplicate", st, NULL);
+
+  blk->header.typeflag = LNKTYPE;
+  finish_header (st, blk, block_ordinal);
+
+  if (remove_files_option)
+    queue_deferred_unlink (st->orig_file_name, false);
+
+  return true;
+}
+
 /* Try to dump stat as a hard link to another file in the archive.
    Return true if successful.  */
 static bool
@@ -1434,8 +1598,6 @@ dump_hard_link (struct tar_stat_info *st)
     {
       struct link lp;
       struct link *duplicate;
-      off_t block_ordinal;
-      union block *blk;
 
       lp.st_dev = st->stat.st_dev;
       lp.st_ino = st->stat.st_ino;
@@ -1448,30 +1610,23 @@ dump_hard_link (struct tar_stat_info *st)
 	  if (duplicate->nlink)
 	    duplicate->nlink--;
 
-	  block_ordinal = current_block_ordinal ();
-	  assign_string (&st->link_name, link_name);
-	  if (NAME_FIELD_SIZE - (archive_format == OLDGNU_FORMAT)
-	      < strlen (link_name))
-	    write_long_link (st);
-
-	  st->stat.st_size = 0;
-	  blk = start_header (st);
-	  if (!blk)
-	    return false;
-	  tar_copy_str (blk->header.linkname, link_name, NAME_FIELD_SIZE);
-
-	  blk->header.typeflag = LNKTYPE;
-	  finish_header (st, blk, block_ordinal);
-
-	  if (remove_files_option)
-	    queue_deferred_unlink (st->orig_file_name, false);
-
-	  return true;
+	  return dump_link_member (st, link_name, false);
 	}
     }
   return false;
 }
 
+/* Try to dump the regular file ST as a link to a file with the same
+   contents that is already in the archive.  Return true if successful.  */
+static bool
+dump_duplicate (struct tar_stat_info *st)
+{
+  if (! (0 < st->fd && S_ISREG (st->stat.st_mode)))
+    return false;
+  char const *link_name = dedup_find (st);
+  return link_name && dump_link_member (st, link_name, true);
+}
+
 static void
 file_count_links (struct tar_stat_info *st)
 {
@@ -1650,7 +1805,7 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
       diag = open_diag;
     }
   else if (f.fd == BADFD
-	   || fstatat (f.fd, f.base, &st->stat, fstatat_flags) < 0)
+	   || stats_fstatat (f.fd, f.base, &st->stat, fstatat_flags) < 0)
     diag = stat_diag;
   else if (file_dumpable_p (&st->stat))
     {
@@ -1717,6 +1872,18 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
   if (!is_dir && dump_hard_link (st))
     return allocated;
 
+  if (!is_dir && deduplicate_option && dump_duplicate (st))
+    {
+      /* dedup_find has read the file.  */
+      if (atime_preserve_option == replace_atime_preserve
+	  && set_file_atime (fd, f.fd, f.base, st->atime) < 0)
+	utime_error (p);
+
+      /* Other links to the file can be stored as links to this member.  */
+      file_count_links (st);
+      return allocated;
+    }
+
   if (is_dir || S_ISREG (st->stat.st_mode) || S_ISCTG (st->stat.st_mode))
     {
       bool ok;
@@ -1768,6 +1935,9 @@ dump_file0 (struct tar_stat_info *st, char const *name, char const *p)
 	  switch (status)
 	    {
 	    case dump_status_ok:
+	      if (deduplicate_option && S_ISREG (st->stat.st_mode))
+		dedup_add (st);
+	      FALLTHROUGH;
 	    case dump_status_short:
 	      file_count_links (st);
 	      break;
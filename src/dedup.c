@@ -0,0 +1,371 @@
+/* Deduplication of file contents.
+
+   Copyright 2026 Free Software Foundation, Inc.
+
+   This file is part of GNU tar.
+
+   GNU tar is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU tar is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <system.h>
+#include <hash.h>
+#include "common.h"
+
+/* With --deduplicate, a regular file whose contents are the same as
+   those of a file already archived is stored as a hard link to it,
+   marked with the GNU.duplicate keyword.
+
+   Only files of the same size can be duplicates, so the contents of
+   a file are hashed only once another file of its size shows up.
+   Files whose hashes match are then compared in full.  The files
+   already archived are reopened by name for this, and are skipped
+   if they have changed since.  With --atime-preserve=replace, their
+   access times are restored afterwards, which changes their status
+   change times, so their modification times are checked instead.  */
+
+/* A regular file already stored in the archive.  */
+struct dedup_file
+{
+  struct dedup_file *next;	/* Next file in the same list */
+  off_t size;
+  uint64_t hash[2];		/* Hash of the contents, if computed */
+  dev_t st_dev;
+  ino_t st_ino;
+  struct timespec atime;	/* Access time before it was archived */
+  struct timespec mtime;	/* Modification time when archived */
+  struct timespec ctime;	/* Status change time when archived */
+  idx_t change_dir;		/* Directory FILE_NAME is relative to */
+  char *file_name;		/* Name of the file */
+  char *link_name;		/* Name of its member */
+};
+
+/* The archived files of a given size.  */
+struct dedup_size
+{
+  off_t size;
+  struct dedup_file *unhashed;	/* Files not hashed yet */
+};
+
+/* Table of struct dedup_size, hashed by size.  */
+static Hash_table *size_table;
+
+/* Table of lists of hashed files, hashed by size and hash.  */
+static Hash_table *file_table;
+
+/* Hash of the contents of the file last passed to dedup_find, if it
+   was computed.  */
+static struct
+{
+  bool valid;
+  dev_t st_dev;
+  ino_t st_ino;
+  uint64_t hash[2];
+} last_hash;
+
+enum { DEDUP_BUFSIZE = 64 * 1024 };
+
+/* Buffers for reading the files.  */
+static char *dedup_buf[2];
+
+static size_t
+size_hash (void const *entry, size_t table_size)
+{
+  struct dedup_size const *ds = entry;
+  return (uintmax_t) ds->size % table_size;
+}
+
+static bool
+size_compare (void const *a, void const *b)
+{
+  struct dedup_size const *dsa = a, *dsb = b;
+  return dsa->size == dsb->size;
+}
+
+static size_t
+file_hash (void const *entry, size_t table_size)
+{
+  struct dedup_file const *d = entry;
+  return (d->hash[0] ^ d->size) % table_size;
+}
+
+static bool
+file_compare (void const *a, void const *b)
+{
+  struct dedup_file const *da = a, *db = b;
+  return (da->size == db->size
+	  && memeq (da->hash, db->hash, sizeof da->hash));
+}
+
+/* Read into BUF up to SIZE bytes of FD, starting at byte OFFSET.
+   Return the number of bytes read, which is less than SIZE only at
+   end of file, or -1 on error.  */
+static idx_t
+read_chunk (int fd, char *buf, idx_t size, off_t offset)
+{
+  idx_t n = 0;
+  while (n < size)
+    {
+      ssize_t r = pread (fd, buf + n, size - n, offset + n);
+      if (r < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  return -1;
+	}
+      if (r == 0)
+	break;
+      n += r;
+    }
+  return n;
+}
+
+static char *
+dedup_buffer (int i)
+{
+  if (!dedup_buf[i])
+    dedup_buf[i] = xmalloc (DEDUP_BUFSIZE);
+  return dedup_buf[i];
+}
+
+/* Compute into H the hash of the SIZE bytes of FD.  Return false if
+   they cannot be read.  The hash need not be strong, since files
+   whose hashes match are compared before being taken as duplicates.  */
+static bool
+hash_contents (int fd, off_t size, uint64_t h[2])
+{
+  char *buf = dedup_buffer (0);
+  h[0] = 0x243f6a8885a308d3;
+  h[1] = 0x13198a2e03707344;
+
+  for (off_t offset = 0; offset < size; )
+    {
+      idx_t n = read_chunk (fd, buf, min (size - offset, DEDUP_BUFSIZE),
+			    offset);
+      if (n <= 0)
+	return false;
+      for (idx_t i = 0; i < n; i += 8)
+	{
+	  uint64_t w = 0;
+	  memcpy (&w, buf + i, min (n - i, 8));
+	  h[0] = (h[0] ^ w) * 0x9e3779b97f4a7c15;
+	  h[0] ^= h[0] >> 32;
+	  h[1] = (h[1] + w) * 0xc2b2ae3d27d4eb4f;
+	  h[1] ^= h[1] >> 29;
+	}
+      offset += n;
+    }
+  return true;
+}
+
+/* Return true if the first SIZE bytes of FD1 and FD2 are the same.  */
+bool
+same_file_contents (int fd1, int fd2, off_t size)
+{
+  char *buf1 = dedup_buffer (0);
+  char *buf2 = dedup_buffer (1);
+
+  for (off_t offset = 0; offset < size; )
+    {
+      idx_t chunk = min (size - offset, DEDUP_BUFSIZE);
+      idx_t n1 = read_chunk (fd1, buf1, chunk, offset);
+      idx_t n2 = read_chunk (fd2, buf2, chunk, offset);
+      if (n1 != chunk || n2 != chunk || !memeq (buf1, buf2, chunk))
+	return false;
+      offset += chunk;
+    }
+  return true;
+}
+
+/* Open the archived file D for reading.  Return -1 if it has changed
+   since it was archived.  */
+static int
+open_dedup_file (struct dedup_file const *d)
+{
+  idx_t saved_dir = chdir_current;
+  chdir_do (d->change_dir);
+  struct fdbase f = fdbase (d->file_name);
+  int fd = f.fd == BADFD ? -1 : openat (f.fd, f.base, open_read_flags);
+  chdir_do (saved_dir);
+
+  struct stat st;
+  if (0 <= fd
+      && ! (fstat (fd, &st) == 0 && SAME_INODE (st, *d)
+	    && st.st_size == d->size
+	    && (atime_preserve_option == replace_atime_preserve
+		? timespec_cmp (get_stat_mtime (&st), d->mtime) == 0
+		: timespec_cmp (get_stat_ctime (&st), d->ctime) == 0)))
+    {
+      close (fd);
+      fd = -1;
+    }
+  return fd;
+}
+
+/* Close FD, which open_dedup_file has opened for D and which has been
+   read, restoring the access time of D if requested.  */
+static void
+close_dedup_file (struct dedup_file const *d, int fd)
+{
+  if (atime_preserve_option == replace_atime_preserve
+      && set_file_atime (fd, AT_FDCWD, d->file_name, d->atime) < 0)
+    utime_error (d->file_name);
+  close (fd);
+}
+
+static void
+free_dedup_file (struct dedup_file *d)
+{
+  free (d->file_name);
+  free (d->link_name);
+  free (d);
+}
+
+/* Add the file D, whose hash has been computed, to FILE_TABLE.  */
+static void
+add_hashed_file (struct dedup_file *d)
+{
+  struct dedup_file *head;
+  d->next = NULL;
+  if (! ((file_table
+	  || (file_table = hash_initialize (0, NULL, file_hash,
+					    file_compare, NULL)))
+	 && (head = hash_insert (file_table, d))))
+    xalloc_die ();
+
+  /* Append to the list, so that the first copy is preferred.  */
+  if (head != d)
+    {
+      while (head->next)
+	head = head->next;
+      head->next = d;
+    }
+}
+
+/* Hash the files in the list DS->unhashed, and move them to
+   FILE_TABLE.  Forget those that have changed.  */
+static void
+hash_files (struct dedup_size *ds)
+{
+  struct dedup_file *d, *next;
+  for (d = ds->unhashed; d; d = next)
+    {
+      next = d->next;
+      int fd = open_dedup_file (d);
+      bool hashed = 0 <= fd && hash_contents (fd, d->size, d->hash);
+      if (0 <= fd)
+	close_dedup_file (d, fd);
+      if (hashed)
+	add_hashed_file (d);
+      else
+	free_dedup_file (d);
+    }
+  ds->unhashed = NULL;
+}
+
+/* Return the member name of a file already archived whose contents
+   are the same as those of the regular file ST, which is open for
+   reading.  Return null if there is none.  */
+char const *
+dedup_find (struct tar_stat_info *st)
+{
+  last_hash.valid = false;
+  if (! (size_table && 0 < st->fd && 0 < st->stat.st_size))
+    return NULL;
+
+  struct dedup_size size_key;
+  size_key.size = st->stat.st_size;
+  struct dedup_size *ds = hash_lookup (size_table, &size_key);
+  if (!ds)
+    return NULL;
+
+  struct dedup_file key;
+  key.size = st->stat.st_size;
+  if (!hash_contents (st->fd, key.size, key.hash))
+    return NULL;
+  last_hash.valid = true;
+  last_hash.st_dev = st->stat.st_dev;
+  last_hash.st_ino = st->stat.st_ino;
+  memcpy (last_hash.hash, key.hash, sizeof key.hash);
+
+  hash_files (ds);
+
+  for (struct dedup_file *d = file_table ? hash_lookup (file_table, &key) : NULL;
+       d; d = d->next)
+    {
+      int fd = open_dedup_file (d);
+      if (0 <= fd)
+	{
+	  bool same = same_file_contents (st->fd, fd, d->size);
+	  close_dedup_file (d, fd);
+	  if (same)
+	    return d->link_name;
+	}
+    }
+  return NULL;
+}
+
+/* Remember the regular file ST, which has just been archived, as one
+   that later files may duplicate.  */
+void
+dedup_add (struct tar_stat_info const *st)
+{
+  if (st->stat.st_size == 0)
+    return;
+
+  char *link_name = NULL;
+  assign_string (&link_name, safer_name_suffix (st->orig_file_name, true,
+						absolute_names_option));
+  if (!transform_name (&link_name, XFORM_LINK))
+    {
+      free (link_name);
+      return;
+    }
+
+  struct dedup_file *d = xmalloc (sizeof *d);
+  d->size = st->stat.st_size;
+  d->st_dev = st->stat.st_dev;
+  d->st_ino = st->stat.st_ino;
+  d->atime = st->atime;
+  d->mtime = st->mtime;
+  d->ctime = st->ctime;
+  d->change_dir = chdir_current;
+  d->file_name = xstrdup (st->orig_file_name);
+  d->link_name = link_name;
+
+  if (last_hash.valid && SAME_INODE (last_hash, st->stat))
+    {
+      /* dedup_find has hashed the file, and thus all other files of
+	 its size.  */
+      memcpy (d->hash, last_hash.hash, sizeof d->hash);
+      add_hashed_file (d);
+      return;
+    }
+
+  struct dedup_size size_key;
+  size_key.size = d->size;
+  struct dedup_size *ds = (size_table
+			   ? hash_lookup (size_table, &size_key) : NULL);
+  if (!ds)
+    {
+      ds = xmalloc (sizeof *ds);
+      ds->size = d->size;
+      ds->unhashed = NULL;
+      if (! ((size_table
+	      || (size_table = hash_initialize (0, NULL, size_hash,
+						size_compare, NULL)))
+	     && hash_insert (size_table, ds)))
+	xalloc_die ();
+    }
+  d->next = ds->unhashed;
+  ds->unhashed = d;
+}
@@ -0,0 +1,115 @@
+/* Digests of member contents.
+
+   Copyright 2026 Free Software Foundation, Inc.
+
+   This file is part of GNU tar.
+
+   GNU tar is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU tar is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <system.h>
+#include <sha256.h>
+#include "common.h"
+
+/* With --digest, the SHA-256 digest of each regular file is stored
+   in the GNU.digest.sha256 keyword of its extended header, as a
+   string of lowercase hexadecimal digits.  When comparing, a file is
+   checked against the digest, and the member data is skipped rather
+   than read.
+
+   As the digest precedes the data, it is computed in a separate pass
+   over the file.  The data is then hashed again as it is archived, to
+   detect files that changed in between.  */
+
+static_assert (DIGEST_HEX_SIZE == 2 * SHA256_DIGEST_SIZE + 1);
+
+enum { DIGEST_BUFSIZE = 64 * 1024 };
+
+/* State of the digest being computed by digest_begin, digest_update
+   and digest_end.  */
+static struct sha256_ctx digest_ctx;
+
+/* Store into DIGEST the hexadecimal form of the binary digest BIN.  */
+static void
+digest_to_hex (unsigned char const bin[SHA256_DIGEST_SIZE],
+	       char digest[DIGEST_HEX_SIZE])
+{
+  static char const hex[] = "0123456789abcdef";
+  for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+    {
+      digest[2 * i] = hex[bin[i] >> 4];
+      digest[2 * i + 1] = hex[bin[i] & 0xf];
+    }
+  digest[2 * SHA256_DIGEST_SIZE] = '\0';
+}
+
+/* Start computing a digest.  */
+void
+digest_begin (void)
+{
+  sha256_init_ctx (&digest_ctx);
+}
+
+/* Add the SIZE bytes of BUF to the digest being computed.  */
+void
+digest_update (void const *buf, idx_t size)
+{
+  sha256_process_bytes (buf, size, &digest_ctx);
+}
+
+/* Store into DIGEST the digest being computed.  */
+void
+digest_end (char digest[DIGEST_HEX_SIZE])
+{
+  unsigned char bin[SHA256_DIGEST_SIZE];
+  sha256_finish_ctx (&digest_ctx, bin);
+  digest_to_hex (bin, digest);
+}
+
+/* Compute into DIGEST the digest of the SIZE bytes of FD, starting at
+   its beginning.  Return false, setting errno, if they cannot all be
+   read.  */
+bool
+file_digest (int fd, off_t size, char digest[DIGEST_HEX_SIZE])
+{
+  static char *buf;
+  struct sha256_ctx ctx;
+  unsigned char bin[SHA256_DIGEST_SIZE];
+
+  if (!buf)
+    buf = xmalloc (DIGEST_BUFSIZE);
+
+  read_ahead (fd, size);
+  enum stats_phase phase = stats_enter (STATS_FILE_READ);
+  sha256_init_ctx (&ctx);
+  for (off_t offset = 0; offset < size; )
+    {
+      ssize_t n = pread (fd, buf, min (size - offset, DIGEST_BUFSIZE),
+			 offset);
+      if (n <= 0)
+	{
+	  if (n < 0 && errno == EINTR)
+	    continue;
+	  if (n == 0)
+	    errno = 0;
+	  stats_leave (phase);
+	  return false;
+	}
+      sha256_process_bytes (buf, n, &ctx);
+      offset += n;
+    }
+  sha256_finish_ctx (&ctx, bin);
+  stats_leave (phase);
+  digest_to_hex (bin, digest);
+  return true;
+}
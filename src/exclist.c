@@ -22,6 +22,7 @@
 #include <quotearg.h>
 #include <flexmember.h>
 #include <fnmatch.h>
+#include <hash.h>
 #include <wordsplit.h>
 #include "common.h"
 
@@ -141,6 +142,136 @@ info_free_exclist (struct tar_stat_info *dir)
 }
 
 
+/* Patterns of the form "*SUFFIX", where SUFFIX has no wildcards or
+   slashes, e.g. "*.o" or "*~", are common in large exclusion lists,
+   and expensive when tried one by one.  They are kept apart from the
+   global exclusion list, in a hash table of their suffixes.  A name
+   matches such a pattern if it ends in SUFFIX or, if the pattern
+   matches leading directories, if one of its leading directories
+   does.  */
+
+struct exclude_suffix
+{
+  char const *suffix;		/* The suffix, not necessarily null-
+				   terminated when looked up */
+  idx_t length;			/* Its length */
+  bool leading_dir;		/* True if it also matches directories
+				   leading to a name */
+};
+
+static Hash_table *exclude_suffix_table;
+
+/* Distinct lengths of the suffixes in the table.  */
+static idx_t *exclude_suffix_lengths;
+static idx_t exclude_suffix_nlengths;
+static idx_t exclude_suffix_lengths_alloc;
+
+static size_t
+exclude_suffix_hash (void const *entry, size_t n_buckets)
+{
+  struct exclude_suffix const *p = entry;
+  size_t value = 0;
+
+  for (idx_t i = 0; i < p->length; i++)
+    value = (value * 31 + (unsigned char) p->suffix[i]) % n_buckets;
+  return value;
+}
+
+static bool
+exclude_suffix_compare (void const *entry1, void const *entry2)
+{
+  struct exclude_suffix const *p1 = entry1;
+  struct exclude_suffix const *p2 = entry2;
+  return (p1->length == p2->length
+	  && memeq (p1->suffix, p2->suffix, p1->length));
+}
+
+/* Add PATTERN with OPTIONS to the exclusion list EX, which must be the
+   global one.  Keep it in the suffix table if possible.  */
+void
+add_exclude_pattern (struct exclude *ex, char const *pattern, int options)
+{
+  char const *suffix = pattern + 1;
+
+  /* The suffix table cannot represent patterns whose "*" must stop at
+     a slash at the start of the name, nor case folding.  */
+  if (! (pattern[0] == '*' && *suffix
+	 && (options & EXCLUDE_WILDCARDS)
+	 && ! (options & (EXCLUDE_REGEX | EXCLUDE_INCLUDE | FNM_CASEFOLD))
+	 && ! ((options & EXCLUDE_ANCHORED) && (options & FNM_FILE_NAME))
+	 && !strpbrk (suffix, "/\\")
+	 && !fnmatch_pattern_has_wildcards (suffix, options)))
+    {
+      add_exclude (ex, pattern, options);
+      return;
+    }
+
+  if (!exclude_suffix_table)
+    {
+      exclude_suffix_table = hash_initialize (0, NULL, exclude_suffix_hash,
+					      exclude_suffix_compare, NULL);
+      if (!exclude_suffix_table)
+	xalloc_die ();
+    }
+
+  struct exclude_suffix *ent = xmalloc (sizeof *ent);
+  ent->length = strlen (suffix);
+  ent->suffix = xmemdup (suffix, ent->length);
+  ent->leading_dir = !!(options & FNM_LEADING_DIR);
+
+  struct exclude_suffix *old = hash_insert (exclude_suffix_table, ent);
+  if (!old)
+    xalloc_die ();
+  if (old != ent)
+    {
+      old->leading_dir |= ent->leading_dir;
+      free ((char *) ent->suffix);
+      free (ent);
+      return;
+    }
+
+  idx_t i;
+  for (i = 0; i < exclude_suffix_nlengths; i++)
+    if (exclude_suffix_lengths[i] == ent->length)
+      break;
+  if (i == exclude_suffix_nlengths)
+    {
+      if (exclude_suffix_nlengths == exclude_suffix_lengths_alloc)
+	exclude_suffix_lengths
+	  = xpalloc (exclude_suffix_lengths, &exclude_suffix_lengths_alloc,
+		     1, -1, sizeof *exclude_suffix_lengths);
+      exclude_suffix_lengths[exclude_suffix_nlengths++] = ent->length;
+    }
+}
+
+/* Return true if NAME matches a pattern in the suffix table.  */
+static bool
+excluded_suffix (char const *name)
+{
+  if (!exclude_suffix_table)
+    return false;
+
+  for (idx_t end = 0; ; end++)
+    {
+      bool at_end = !name[end];
+      if (at_end || name[end] == '/')
+	for (idx_t i = 0; i < exclude_suffix_nlengths; i++)
+	  {
+	    idx_t len = exclude_suffix_lengths[i];
+	    if (len <= end)
+	      {
+		struct exclude_suffix key = { name + end - len, len };
+		struct exclude_suffix const *ent
+		  = hash_lookup (exclude_suffix_table, &key);
+		if (ent && (at_end || ent->leading_dir))
+		  return true;
+	      }
+	  }
+      if (at_end)
+	return false;
+    }
+}
+
 /* Return nonzero if file NAME is excluded.  */
 bool
 excluded_name (char const *name, struct tar_stat_info *st)
@@ -154,7 +285,7 @@ excluded_name (char const *name, struct tar_stat_info *st)
   name += FILE_SYSTEM_PREFIX_LEN (name);
 
   /* Try global exclusion list first */
-  if (excluded_file_name (excluded, name))
+  if (excluded_suffix (name) || excluded_file_name (excluded, name))
     return true;
 
   if (!st)
@@ -28,6 +28,7 @@
 #include <priv-set.h>
 #include <root-uid.h>
 #include <same-inode.h>
+#include <sys/socket.h>
 #include <utimens.h>
 
 #include "common.h"
@@ -104,8 +105,9 @@ contains_dot_dot (char const *name)
 
 struct delayed_set_stat
   {
-    /* Next directory in list.  */
+    /* Next and previous directories in list.  */
     struct delayed_set_stat *next;
+    struct delayed_set_stat *prev;
 
     /* Metadata for this directory.  */
     dev_t st_dev;
@@ -154,7 +156,10 @@ struct delayed_set_stat
 
 static struct delayed_set_stat *delayed_set_stat_head;
 
-/* Table of delayed stat updates hashed by path; null if none.  */
+/* Table of delayed stat updates hashed by path; null if none.
+   Directory names are unique in the table, so that a directory can be
+   found without walking the list, which may be very long when
+   directory restoration is delayed to the end of the extraction.  */
 static Hash_table *delayed_set_stat_table;
 
 /* A link whose creation we have delayed.  */
@@ -255,6 +260,11 @@ ds_compare (void const *a, void const *b)
   return streq (dsa->file_name, dsb->file_name);
 }
 
+static void start_finish_workers (void);
+static bool finish_workers_available (void);
+static bool pass_to_finish_worker (char const *, struct tar_stat_info const *,
+				   int, mode_t, mode_t, char, bool, int);
+
 /*  Set up to extract files.  */
 void
 extr_init (void)
@@ -275,6 +285,9 @@ extr_init (void)
       umask (newdir_umask);	/* restore the kernel umask */
       current_umask = newdir_umask;
     }
+
+  if (extract_workers_option && !to_stdout_option && !to_command_option)
+    start_finish_workers ();
 }
 
 /* Use fchmod if possible, fchmodat otherwise.  */
@@ -428,10 +441,10 @@ check_time (char const *file_name, struct timespec t)
    ATFLAG specifies the flag to use when statting the file.  */
 
 static void
-set_stat (char const *file_name,
-	  struct tar_stat_info const *st,
-	  int fd, mode_t current_mode, mode_t current_mode_mask,
-	  char typeflag, bool interdir, int atflag)
+set_stat0 (char const *file_name,
+	   struct tar_stat_info const *st,
+	   int fd, mode_t current_mode, mode_t current_mode_mask,
+	   char typeflag, bool interdir, int atflag)
 {
   /* Do the utime before the chmod because some versions of utime are
      broken and trash the modes of the file.  */
@@ -496,22 +509,56 @@ set_stat (char const *file_name,
   xattrs_selinux_set (st, file_name, typeflag);
 }
 
+static void
+set_stat (char const *file_name,
+	  struct tar_stat_info const *st,
+	  int fd, mode_t current_mode, mode_t current_mode_mask,
+	  char typeflag, bool interdir, int atflag)
+{
+  enum stats_phase phase = stats_enter (STATS_SET_STAT);
+  set_stat0 (file_name, st, fd, current_mode, current_mode_mask,
+	     typeflag, interdir, atflag);
+  stats_leave (phase);
+}
+
+/* Return the entry for the directory named FILE_NAME in the
+   delayed_set_stat list, or null if there is none.  */
+static struct delayed_set_stat *
+find_delayed_set_stat (char const *file_name)
+{
+  if (!delayed_set_stat_table)
+    return NULL;
+  struct delayed_set_stat key;
+  key.file_name = (char *) file_name;
+  return hash_lookup (delayed_set_stat_table, &key);
+}
+
 /* Find the direct ancestor of FILE_NAME in the delayed_set_stat list.  */
 static struct delayed_set_stat *
 find_direct_ancestor (char const *file_name)
 {
-  struct delayed_set_stat *h = delayed_set_stat_head;
-  while (h)
-    {
-      if (! h->metadata_set
-	  && strncmp (file_name, h->file_name, h->file_name_len) == 0
-	  && ISSLASH (file_name[h->file_name_len])
-	  && (last_component (file_name + h->file_name_len + 1)
-	      == file_name + h->file_name_len + 1))
-	break;
-      h = h->next;
-    }
-  return h;
+  char const *base = last_component (file_name);
+  idx_t dirlen = base - file_name;
+  if (! (dirlen && ISSLASH (file_name[dirlen - 1])))
+    return NULL;
+
+  char *dir = ximemdup0 (file_name, dirlen - 1);
+  struct delayed_set_stat *h = find_delayed_set_stat (dir);
+  free (dir);
+  return h && ! h->metadata_set ? h : NULL;
+}
+
+/* Remove DATA from the delayed_set_stat list and table.  */
+static void
+unlink_delayed_set_stat (struct delayed_set_stat *data)
+{
+  if (data->prev)
+    data->prev->next = data->next;
+  else
+    delayed_set_stat_head = data->next;
+  if (data->next)
+    data->next->prev = data->prev;
+  hash_remove (delayed_set_stat_table, data);
 }
 
 /* For each entry H in the leading prefix of entries in HEAD that do
@@ -595,6 +642,9 @@ delay_set_stat (char const *file_name, struct tar_stat_info const *st,
     {
       data = xmalloc (sizeof (*data));
       data->next = delayed_set_stat_head;
+      data->prev = NULL;
+      if (delayed_set_stat_head)
+	delayed_set_stat_head->prev = data;
       delayed_set_stat_head = data;
       data->file_name_len = file_name_len;
       data->file_name = xstrdup (file_name);
@@ -658,24 +708,18 @@ delay_set_stat (char const *file_name, struct tar_stat_info const *st,
 static bool
 update_interdir_set_stat (char const *dir)
 {
-  if (delayed_set_stat_table)
+  struct delayed_set_stat *data = find_delayed_set_stat (dir);
+  if (data && data->interdir)
     {
-      struct delayed_set_stat key, *data;
-
-      key.file_name = (char *) dir;
-      data = hash_lookup (delayed_set_stat_table, &key);
-      if (data && data->interdir)
-	{
-	  data->st_dev = current_stat_info.stat.st_dev;
-	  data->st_ino = current_stat_info.stat.st_ino;
-	  data->mode = current_stat_info.stat.st_mode;
-	  data->uid = current_stat_info.stat.st_uid;
-	  data->gid = current_stat_info.stat.st_gid;
-	  data->atime = current_stat_info.atime;
-	  data->mtime = current_stat_info.mtime;
-	  data->interdir = false;
-	  return true;
-	}
+      data->st_dev = current_stat_info.stat.st_dev;
+      data->st_ino = current_stat_info.stat.st_ino;
+      data->mode = current_stat_info.stat.st_mode;
+      data->uid = current_stat_info.stat.st_uid;
+      data->gid = current_stat_info.stat.st_gid;
+      data->atime = current_stat_info.atime;
+      data->mtime = current_stat_info.mtime;
+      data->interdir = false;
+      return true;
     }
   return false;
 }
@@ -733,40 +777,29 @@ free_delayed_set_stat (struct delayed_set_stat *data)
 void
 remove_delayed_set_stat (const char *fname)
 {
-  struct delayed_set_stat *data, *next, *prev = NULL;
-  for (data = delayed_set_stat_head; data; data = next)
+  struct delayed_set_stat *data = find_delayed_set_stat (fname);
+  if (data && chdir_current == data->change_dir)
     {
-      next = data->next;
-      if (chdir_current == data->change_dir
-	  && streq (data->file_name, fname))
-	{
-	  hash_remove (delayed_set_stat_table, data);
-	  free_delayed_set_stat (data);
-	  if (prev)
-	    prev->next = next;
-	  else
-	    delayed_set_stat_head = next;
-	  return;
-	}
-      else
-	prev = data;
+      unlink_delayed_set_stat (data);
+      free_delayed_set_stat (data);
     }
 }
 
 static void
 fixup_delayed_set_stat (char const *src, char const *dst)
 {
-  struct delayed_set_stat *data;
-  for (data = delayed_set_stat_head; data; data = data->next)
+  struct delayed_set_stat *data = find_delayed_set_stat (src);
+  if (data && chdir_current == data->change_dir)
     {
-      if (chdir_current == data->change_dir
-	  && streq (data->file_name, src))
-	{
-	  free (data->file_name);
-	  data->file_name = xstrdup (dst);
-	  data->file_name_len = strlen (dst);
-	  return;
-	}
+      /* DST, if it had an entry, has been replaced.  */
+      remove_delayed_set_stat (dst);
+
+      hash_remove (delayed_set_stat_table, data);
+      free (data->file_name);
+      data->file_name = xstrdup (dst);
+      data->file_name_len = strlen (dst);
+      if (! hash_insert (delayed_set_stat_table, data))
+	xalloc_die ();
     }
 }
 
@@ -782,7 +815,18 @@ make_directories (char *file_name, bool *interdir_made)
   char *parent_end = NULL;
   int parent_errno;
 
-  for (cursor = cursor0; *cursor; cursor++)
+  /* Directories that fdbase has opened are known to exist, so start
+     after them.  If that leaves nothing to create, the file's parent
+     directory has been removed behind our back: forget what is known
+     and check every directory.  */
+  idx_t known = fdbase_known_prefix (file_name);
+  if (known && last_component (file_name + known) == file_name + known)
+    {
+      fdbase_clear ();
+      known = 0;
+    }
+
+  for (cursor = known ? file_name + known : cursor0; *cursor; cursor++)
     {
       mode_t mode;
       mode_t desired_mode;
@@ -1020,6 +1064,20 @@ set_xattr (MAYBE_UNUSED char const *file_name,
   return 0;
 }
 
+/* Open the directory of DATA for restoring its status.  Return the
+   descriptor, or -1 if it cannot be opened.  */
+static int
+open_delayed_directory (struct delayed_set_stat const *data)
+{
+  struct fdbase f = fdbase (data->file_name);
+  if (f.fd == BADFD)
+    return -1;
+  int flags = (O_RDONLY | O_BINARY | O_CLOEXEC | O_DIRECTORY | O_NOCTTY
+	       | O_NONBLOCK
+	       | (data->atflag & AT_SYMLINK_NOFOLLOW ? O_NOFOLLOW : 0));
+  return openat (f.fd, f.base, flags);
+}
+
 /* Fix the statuses of all directories whose statuses need fixing, and
    which are not ancestors of FILE_NAME.  If METADATA_SET,
    do this for all such directories; otherwise, stop at the
@@ -1088,13 +1146,28 @@ apply_nonancestor_delayed_set_stat (char const *file_name, bool metadata_set)
 	  sb.acls_d_ptr = data->acls_d_ptr;
 	  sb.acls_d_len = data->acls_d_len;
 	  sb.xattr_map = data->xattr_map;
-	  set_stat (data->file_name, &sb,
-		    -1, current_mode, current_mode_mask,
-		    DIRTYPE, data->interdir, data->atflag);
+
+	  /* Let a worker restore the status through a descriptor.
+	     Unlike the file name, the descriptor stays usable whatever
+	     the status of the ancestors, which may be restored before
+	     the worker gets to this directory.  */
+	  int fd = (finish_workers_available ()
+		    ? open_delayed_directory (data) : -1);
+	  if (! (0 <= fd
+		 && pass_to_finish_worker (data->file_name, &sb, fd,
+					   current_mode, current_mode_mask,
+					   DIRTYPE, data->interdir,
+					   data->atflag)))
+	    {
+	      set_stat (data->file_name, &sb,
+			fd, current_mode, current_mode_mask,
+			DIRTYPE, data->interdir, data->atflag);
+	      if (0 <= fd && close (fd) < 0)
+		close_error (data->file_name);
+	    }
 	}
 
-      delayed_set_stat_head = data->next;
-      hash_remove (delayed_set_stat_table, data);
+      unlink_delayed_set_stat (data);
       free_delayed_set_stat (data);
     }
 }
@@ -1243,7 +1316,280 @@ extract_dir (char *file_name, char UNNAMED (typeflag))
   return status == 0;
 }
 
+/* Worker processes that finish extracting regular files.  Once tar
+   has written the data of a file, it passes the file descriptor to a
+   worker, which sets the file status and closes it.  On network file
+   systems, these are the steps that wait for the server, and the
+   workers let them proceed in parallel while tar goes on reading the
+   archive.
+
+   All requests for a given file name go to the same worker, which
+   serves them in order.  Thus if the archive holds a name more than
+   once, the status of its last member is the one restored.  */
+
+/* Request to a worker, followed by the file name.  */
+struct finish_request
+{
+  struct timespec atime;
+  struct timespec mtime;
+  uid_t uid;
+  gid_t gid;
+  mode_t mode;
+  mode_t current_mode;
+  mode_t current_mode_mask;
+  int atflag;
+  char typeflag;
+  bool interdir;
+  idx_t name_size;
+};
+
+struct finish_worker
+{
+  pid_t pid;
+  int sock;			/* Socket to the worker, or -1 */
+};
+
+static struct finish_worker *finish_workers;
+static idx_t finish_worker_count;
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+/* Receive from SOCK a request and the descriptor attached to it.
+   Store the file name in *NAME, reallocating it as needed, and the
+   descriptor in *FD, or -1 if none was attached.  Return false at end
+   of input.  */
+static bool
+receive_finish_request (int sock, struct finish_request *req,
+			char **name, idx_t *name_alloc, int *fd)
+{
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = { .iov_base = req, .iov_len = sizeof *req };
+  struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+			.msg_control = control.buf,
+			.msg_controllen = sizeof control.buf };
+  ssize_t n;
+
+  while ((n = recvmsg (sock, &msg, 0)) < 0)
+    if (errno != EINTR)
+      return false;
+  if (n == 0)
+    return false;
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+  *fd = -1;
+  if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+    memcpy (fd, CMSG_DATA (cmsg), sizeof *fd);
+  if (full_read (sock, (char *) req + n, sizeof *req - n) != sizeof *req - n)
+    return false;
+  if (*name_alloc <= req->name_size)
+    *name = xpalloc (*name, name_alloc, req->name_size + 1 - *name_alloc,
+		     -1, 1);
+  if (full_read (sock, *name, req->name_size) != req->name_size)
+    return false;
+  (*name)[req->name_size] = '\0';
+  return true;
+}
+
+/* Serve the requests received from SOCK, then exit.  */
+static _Noreturn void
+run_finish_worker (int sock)
+{
+  struct finish_request req;
+  char *name = NULL;
+  idx_t name_alloc = 0;
+  int fd;
+
+  /* Only the main process applies the delayed status changes.  */
+  fatal_exit_hook = NULL;
 
+  while (receive_finish_request (sock, &req, &name, &name_alloc, &fd))
+    {
+      if (fd < 0)
+	{
+	  paxerror (0, _("%s: Cannot restore status: descriptor not received"),
+		    quotearg_colon (name));
+	  continue;
+	}
+
+      struct tar_stat_info st;
+      tar_stat_init (&st);
+      st.atime = req.atime;
+      st.mtime = req.mtime;
+      st.stat.st_uid = req.uid;
+      st.stat.st_gid = req.gid;
+      st.stat.st_mode = req.mode;
+      set_stat (name, &st, fd, req.current_mode, req.current_mode_mask,
+		req.typeflag, req.interdir, req.atflag);
+      if (close (fd) < 0)
+	close_error (name);
+    }
+
+  /* Do not flush the standard output, which holds a copy of the
+     listing buffered by the main process at the time of fork.  */
+  _exit (exit_status);
+}
+
+/* Start the worker processes requested by --extract-workers.  */
+static void
+start_finish_workers (void)
+{
+  finish_workers = xinmalloc (extract_workers_option, sizeof *finish_workers);
+  for (idx_t i = 0; i < extract_workers_option; i++)
+    {
+      int sv[2];
+      if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+	{
+	  paxwarn (errno, _("cannot start extraction workers"));
+	  break;
+	}
+      pid_t pid = xfork ();
+      if (pid == 0)
+	{
+	  close (sv[0]);
+	  for (idx_t j = 0; j < i; j++)
+	    close (finish_workers[j].sock);
+	  run_finish_worker (sv[1]);
+	}
+      close (sv[1]);
+      finish_workers[i].pid = pid;
+      finish_workers[i].sock = sv[0];
+      finish_worker_count = i + 1;
+    }
+}
+
+/* Tell the workers that there are no more requests, and wait for them
+   to finish.  */
+static void
+stop_finish_workers (void)
+{
+  for (idx_t i = 0; i < finish_worker_count; i++)
+    if (0 <= finish_workers[i].sock)
+      close (finish_workers[i].sock);
+
+  for (idx_t i = 0; i < finish_worker_count; i++)
+    {
+      int wait_status;
+      while (waitpid (finish_workers[i].pid, &wait_status, 0) < 0)
+	if (errno != EINTR)
+	  {
+	    waitpid_error (_("extraction worker"));
+	    wait_status = 0;
+	    break;
+	  }
+      if (WIFSIGNALED (wait_status))
+	paxerror (0, _("Extraction worker died with signal %d"),
+		  WTERMSIG (wait_status));
+      else if (WEXITSTATUS (wait_status) != 0)
+	set_exit_status (WEXITSTATUS (wait_status));
+    }
+
+  free (finish_workers);
+  finish_workers = NULL;
+  finish_worker_count = 0;
+}
+
+/* Send to SOCK the N bytes at BUF, possibly attaching descriptor FD.  */
+static bool
+send_to_worker (int sock, int fd, void const *buf, idx_t n)
+{
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  char const *p = buf;
+
+  while (n)
+    {
+      struct iovec iov = { .iov_base = (void *) p, .iov_len = n };
+      struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+      if (0 <= fd)
+	{
+	  msg.msg_control = control.buf;
+	  msg.msg_controllen = sizeof control.buf;
+	  struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+	  cmsg->cmsg_level = SOL_SOCKET;
+	  cmsg->cmsg_type = SCM_RIGHTS;
+	  cmsg->cmsg_len = CMSG_LEN (sizeof fd);
+	  memcpy (CMSG_DATA (cmsg), &fd, sizeof fd);
+	}
+      ssize_t sent = sendmsg (sock, &msg, MSG_NOSIGNAL);
+      if (sent < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  return false;
+	}
+      fd = -1;
+      p += sent;
+      n -= sent;
+    }
+  return true;
+}
+
+/* Return true if there are workers to pass files to.  */
+static bool
+finish_workers_available (void)
+{
+  /* Workers do not restore extended attributes.  */
+  return (finish_worker_count
+	  && ! (xattrs_option || 0 < acls_option
+		|| 0 < selinux_context_option));
+}
+
+/* Pass FD, the descriptor of the file FILE_NAME, to a worker that
+   restores its status as set_stat would, and closes it.  ST,
+   CURRENT_MODE, CURRENT_MODE_MASK, TYPEFLAG, INTERDIR and ATFLAG are
+   as for set_stat.  Return false if no worker could take the file,
+   which is then left to the caller.  */
+static bool
+pass_to_finish_worker (char const *file_name, struct tar_stat_info const *st,
+		       int fd, mode_t current_mode, mode_t current_mode_mask,
+		       char typeflag, bool interdir, int atflag)
+{
+  if (! finish_workers_available ())
+    return false;
+
+  struct finish_request req = {
+    .atime = st->atime,
+    .mtime = st->mtime,
+    .uid = st->stat.st_uid,
+    .gid = st->stat.st_gid,
+    .mode = st->stat.st_mode,
+    .current_mode = current_mode,
+    .current_mode_mask = current_mode_mask,
+    .atflag = atflag,
+    .typeflag = typeflag,
+    .interdir = interdir,
+    .name_size = strlen (file_name)
+  };
+
+  /* Pick the worker by file name, so that the requests for a name are
+     served in order.  */
+  struct finish_worker *w
+    = &finish_workers[hash_string (file_name, finish_worker_count)];
+  if (w->sock < 0)
+    return false;
+  if (send_to_worker (w->sock, fd, &req, sizeof req)
+      && send_to_worker (w->sock, -1, file_name, req.name_size))
+    {
+      if (close (fd) < 0)
+	close_error (file_name);
+      return true;
+    }
+
+  /* The worker is gone.  A partially sent request is discarded by the
+     worker, so the file is still ours.  */
+  close (w->sock);
+  w->sock = -1;
+  return false;
+}
 
 static int
 open_output_file (char const *file_name, char typeflag, mode_t mode,
@@ -1366,6 +1712,7 @@ extract_file (char *file_name, char typeflag)
     }
 
   mv_begin_read (&current_stat_info);
+  struct timespec data_start = stats_data_begin ();
   if (current_stat_info.is_sparse)
     sparse_extract_file (fd, &current_stat_info, &size);
   else
@@ -1373,6 +1720,16 @@ extract_file (char *file_name, char typeflag)
       {
 	mv_size_left (size);
 
+	/* Copy whole records from the archive file, if possible.  */
+	enum stats_phase phase = stats_enter (STATS_FILE_WRITE);
+	off_t copied = copy_archive_records (fd, size);
+	stats_leave (phase);
+	if (copied)
+	  {
+	    size -= copied;
+	    continue;
+	  }
+
 	/* Locate data, determine max length writeable, write it,
 	   block that we have used the data, then check if the write
 	   worked.  */
@@ -1388,8 +1745,10 @@ extract_file (char *file_name, char typeflag)
 
 	if (written > size)
 	  written = size;
+	phase = stats_enter (STATS_FILE_WRITE);
 	errno = 0;
 	idx_t count = blocking_write (fd, charptr (data_block), written);
+	stats_leave (phase);
 	size -= written;
 
 	set_next_block_after (charptr (data_block) + written - 1);
@@ -1404,6 +1763,7 @@ extract_file (char *file_name, char typeflag)
 
   skim_file (size, false);
   current_stat_info.skipped = true;
+  stats_data_end (data_start, current_stat_info.stat.st_size - size);
 
   mv_end ();
 
@@ -1414,10 +1774,16 @@ extract_file (char *file_name, char typeflag)
     return true;
 
   if (! to_command_option)
-    set_stat (file_name, &current_stat_info, fd,
-	      current_mode, current_mode_mask, typeflag, false,
-	      (old_files_option == OVERWRITE_OLD_FILES
-	       ? 0 : AT_SYMLINK_NOFOLLOW));
+    {
+      int atflag = (old_files_option == OVERWRITE_OLD_FILES
+		    ? 0 : AT_SYMLINK_NOFOLLOW);
+      if (pass_to_finish_worker (file_name, &current_stat_info, fd,
+				 current_mode, current_mode_mask,
+				 typeflag, false, atflag))
+	return true;
+      set_stat (file_name, &current_stat_info, fd,
+		current_mode, current_mode_mask, typeflag, false, atflag);
+    }
 
   status = close (fd);
   if (status < 0)
@@ -1563,6 +1929,100 @@ create_placeholder_file (char *file_name, bool is_symlink, bool *interdir_made)
   return false;
 }
 
+/* Copy the SIZE bytes of IFD to OFD.  Return true if successful.  */
+static bool
+copy_file_contents (int ifd, int ofd, off_t size)
+{
+  off_t copied = 0;
+  while (copied < size)
+    {
+      ssize_t n = copy_file_range (ifd, NULL, ofd, NULL,
+				   min (size - copied, SSIZE_MAX), 0);
+      if (n <= 0)
+	break;
+      copied += n;
+    }
+
+  char buf[BLOCKSIZE * 16];
+  while (copied < size)
+    {
+      ssize_t n = pread (ifd, buf, min (size - copied, sizeof buf), copied);
+      if (n <= 0)
+	return false;
+      if (full_write (ofd, buf, n) != n)
+	return false;
+      copied += n;
+    }
+  return true;
+}
+
+/* Extract FILE_NAME as a copy of the member it duplicates.  */
+static bool
+extract_duplicate (char *file_name)
+{
+  char const *link_name = current_stat_info.link_name;
+  bool interdir_made = false;
+  mode_t mode = (current_stat_info.stat.st_mode & MODE_RWX
+		 & ~ (0 < same_owner_option ? S_IRWXG | S_IRWXO : 0));
+  mode_t current_mode = 0;
+  mode_t current_mode_mask = 0;
+  struct stat st;
+
+  struct fdbase f1 = fdbase1 (link_name);
+  int ifd = f1.fd == BADFD ? -1 : openat (f1.fd, f1.base, open_read_flags);
+  if (ifd < 0)
+    {
+      open_error (link_name);
+      return false;
+    }
+  if (fstat (ifd, &st) < 0)
+    {
+      stat_error (link_name);
+      close (ifd);
+      return false;
+    }
+
+  int fd, file_created;
+  while (((file_created = set_xattr (file_name, &current_stat_info,
+				     mode | S_IWUSR, REGTYPE))
+	  < 0)
+	 || ((fd = open_output_file (file_name, REGTYPE, mode,
+				     file_created, &current_mode,
+				     &current_mode_mask))
+	     < 0))
+    {
+      enum recover recover
+	= maybe_recoverable (file_name, true, &interdir_made);
+      if (recover != RECOVER_OK)
+	{
+	  close (ifd);
+	  if (recover == RECOVER_SKIP)
+	    return true;
+	  open_error (file_name);
+	  return false;
+	}
+    }
+
+  enum stats_phase phase = stats_enter (STATS_FILE_WRITE);
+  bool ok = copy_file_contents (ifd, fd, st.st_size);
+  stats_leave (phase);
+  if (!ok)
+    write_error (file_name);
+  close (ifd);
+
+  set_stat (file_name, &current_stat_info, fd, current_mode,
+	    current_mode_mask, REGTYPE, false,
+	    (old_files_option == OVERWRITE_OLD_FILES
+	     ? 0 : AT_SYMLINK_NOFOLLOW));
+
+  if (close (fd) < 0)
+    {
+      close_error (file_name);
+      ok = false;
+    }
+  return ok;
+}
+
 static bool
 extract_link (char *file_name, char UNNAMED (typeflag))
 {
@@ -1572,6 +2032,11 @@ extract_link (char *file_name, char UNNAMED (typeflag))
 
   link_name = current_stat_info.link_name;
 
+  /* Unless --deduplicate is given, a duplicate is extracted as a file
+     of its own, so that modifying it does not affect the original.  */
+  if (current_stat_info.is_duplicate && !deduplicate_option)
+    return extract_duplicate (file_name);
+
   if (absolute_names_option | dereference_option
       && ((! absolute_names_option && contains_dot_dot (link_name))
 	  || find_delayed_link_source (link_name)))
@@ -2026,6 +2491,11 @@ extract_finish (void)
   /* First, fix the status of ordinary directories that need fixing.  */
   apply_nonancestor_delayed_set_stat ("", false);
 
+  /* Wait for the files and directories passed to workers to be
+     finished.  */
+  if (finish_worker_count)
+    stop_finish_workers ();
+
   /* Then, apply delayed links, so that they don't affect delayed
      directory status-setting for ordinary directories.  */
   apply_delayed_links ();
@@ -24,7 +24,9 @@
 #include <mkdtempat.h>
 #include <quotearg.h>
 #include <same-inode.h>
+#include <sys/socket.h>
 #include "common.h"
+#include <rmt.h>
 
 /* Incremental dump specialities.  */
 
@@ -59,7 +61,11 @@ enum
        other orig) is marked with the DIRF_RENAMED flag.  This marks a starting
        point from which append_incremental_renames starts encoding renames for
        this chain. */
-    DIRF_RENAMED= 1 << 4
+    DIRF_RENAMED= 1 << 4,
+
+    /* Directory entries were taken from the snapshot, as the change
+       journal shows that the directory is unchanged.  */
+    DIRF_UNCHANGED = 1 << 5
   };
 
 struct dumpdir                 /* Dump directory listing */
@@ -416,10 +422,10 @@ find_directory (const char *name)
     return NULL;
   else
     {
-      char *caname = normalize_filename (chdir_current, name);
-      struct directory *dir = make_directory (name, caname);
-      struct directory *ret = hash_lookup (directory_table, dir);
-      free_directory (dir);
+      struct directory key;
+      key.caname = normalize_filename (chdir_current, name);
+      struct directory *ret = hash_lookup (directory_table, &key);
+      free (key.caname);
       return ret;
     }
 }
@@ -457,13 +463,10 @@ find_directory_meta (dev_t dev, ino_t ino)
     return NULL;
   else
     {
-      struct directory *dir = make_directory ("", NULL);
-      struct directory *ret;
-      dir->st_dev = dev;
-      dir->st_ino = ino;
-      ret = hash_lookup (directory_meta_table, dir);
-      free_directory (dir);
-      return ret;
+      struct directory key;
+      key.st_dev = dev;
+      key.st_ino = ino;
+      return hash_lookup (directory_meta_table, &key);
     }
 }
 
@@ -771,16 +774,336 @@ maketagdumpdir (struct directory *directory)
   free (new_dump);
 }
 
+/* Prefetching of directory scans.
+
+   With --scan-workers=N, scan_directory passes the entries of each
+   directory it reads to N worker processes, which stat them and read
+   the subdirectories among them ahead of the main process.  The main
+   process still scans every directory itself and in the same order,
+   so the snapshot file and the archive are unchanged: the workers only
+   bring the inodes and directory blocks into the cache, which lets the
+   file system serve many of these requests at once.
+
+   The same workers serve --read-ahead: dump_dir0 passes them the
+   entries about to be archived, and they have the system start
+   reading the regular files among them.
+
+   Each message starts with a byte giving the kind of request, which
+   is followed by the entry names.  */
+
+/* Kinds of requests.  */
+enum
+  {
+    PREFETCH_DIRECTORIES = 'D',	/* Stat entries, read subdirectories */
+    PREFETCH_FILES = 'F'	/* Read ahead regular files */
+  };
+
+/* Maximum size of a message.  */
+enum { SCAN_MESSAGE_SIZE = 16 * 1024 };
+
+/* Socket to the scan workers, or -1 if there are none.  */
+static int scan_sock = -1;
+
+static pid_t *scan_worker_pids;
+static idx_t scan_worker_count;
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+/* Receive from SOCK a message into BUF, which has room for
+   SCAN_MESSAGE_SIZE bytes, and store the descriptor attached to it in
+   *FD, or -1 if there is none.  Return the size of the message, or a
+   nonpositive value at end of input.  */
+static ssize_t
+receive_scan_request (int sock, char *buf, int *fd)
+{
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = { .iov_base = buf, .iov_len = SCAN_MESSAGE_SIZE };
+  struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+			.msg_control = control.buf,
+			.msg_controllen = sizeof control.buf };
+  ssize_t n;
+
+  while ((n = recvmsg (sock, &msg, 0)) < 0)
+    if (errno != EINTR)
+      return -1;
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+  *fd = -1;
+  if (cmsg && cmsg->cmsg_type == SCM_RIGHTS)
+    memcpy (fd, CMSG_DATA (cmsg), sizeof *fd);
+  return n;
+}
+
+/* Read the entries of the directory NAME in the directory FD, for
+   the benefit of the main process.  */
+static void
+prefetch_subdirectory (int fd, char const *name)
+{
+  int subfd = openat (fd, name, open_read_flags | O_DIRECTORY);
+  if (subfd < 0)
+    return;
+  DIR *dirp = fdopendir (subfd);
+  if (!dirp)
+    {
+      close (subfd);
+      return;
+    }
+  while (readdir (dirp))
+    continue;
+  closedir (dirp);
+}
+
+/* Have the system start reading the first READ_AHEAD_SIZE bytes of
+   NAME in the directory FD, if it is a regular file.  */
+static void
+prefetch_file (MAYBE_UNUSED int fd, MAYBE_UNUSED char const *name)
+{
+#if HAVE_POSIX_FADVISE
+  int filefd = openat (fd, name, open_read_flags | O_NOFOLLOW);
+  if (filefd < 0)
+    return;
+  struct stat st;
+  if (fstat (filefd, &st) == 0 && S_ISREG (st.st_mode) && 0 < st.st_size)
+    posix_fadvise (filefd, 0, min (st.st_size, READ_AHEAD_SIZE),
+		   POSIX_FADV_WILLNEED);
+  close (filefd);
+#endif
+}
+
+/* Serve the requests received from SOCK, then exit.  Errors are of no
+   concern here: the main process will diagnose them when it gets to
+   the same files.  */
+static _Noreturn void
+run_scan_worker (int sock)
+{
+  static char buf[SCAN_MESSAGE_SIZE + 1];
+  ssize_t n;
+  int fd;
+
+  fatal_exit_hook = NULL;
+
+  while (0 < (n = receive_scan_request (sock, buf, &fd)))
+    if (0 <= fd)
+      {
+	buf[n] = '\0';
+	for (char const *name = buf + 1; name < buf + n;
+	     name += strlen (name) + 1)
+	  if (buf[0] == PREFETCH_FILES)
+	    prefetch_file (fd, name);
+	  else
+	    {
+	      struct stat st;
+	      if (fstatat (fd, name, &st, fstatat_flags) == 0
+		  && S_ISDIR (st.st_mode))
+		prefetch_subdirectory (fd, name);
+	    }
+	close (fd);
+      }
+
+  _exit (EXIT_SUCCESS);
+}
+
+/* Start N worker processes.  */
+static void
+start_workers (idx_t n)
+{
+  int sv[2];
+
+  if (socketpair (AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0)
+    {
+      paxwarn (errno, _("cannot start scan workers"));
+      return;
+    }
+
+  scan_worker_pids = xinmalloc (n, sizeof *scan_worker_pids);
+  for (idx_t i = 0; i < n; i++)
+    {
+      pid_t pid = xfork ();
+      if (pid == 0)
+	{
+	  /* Do not keep open the pipe to a compressor or to the I/O
+	     process, whose reader would then never see its end.  */
+	  close (sv[0]);
+	  if (0 <= archive && !_isrmt (archive))
+	    close (archive);
+	  run_scan_worker (sv[1]);
+	}
+      scan_worker_pids[i] = pid;
+      scan_worker_count = i + 1;
+    }
+  close (sv[1]);
+  scan_sock = sv[0];
+}
+
+/* Start the worker processes requested by --scan-workers, unless
+   workers are already running, e.g. for --read-ahead, in which case
+   they are used instead.  Return true if workers were started, and
+   are then to be stopped by the caller.  */
+bool
+start_scan_workers (void)
+{
+  if (scan_sock < 0 && scan_workers_option != 0)
+    {
+      start_workers (scan_workers_option);
+      return 0 <= scan_sock;
+    }
+  return false;
+}
+
+/* Start the worker processes that serve --read-ahead: as many as
+   requested by --scan-workers, or one.  */
+void
+start_read_ahead_workers (void)
+{
+#if HAVE_POSIX_FADVISE
+  if (read_ahead_option != 0 && scan_sock < 0)
+    start_workers (scan_workers_option ? scan_workers_option : 1);
+#endif
+}
+
+/* Tell the scan workers that there is nothing more to prefetch, and
+   wait for them to finish.  */
+void
+stop_scan_workers (void)
+{
+  if (scan_sock < 0)
+    return;
+  /* Processes forked since the workers started may hold a copy of the
+     socket, so shut it down rather than only closing it.  */
+  shutdown (scan_sock, SHUT_WR);
+  close (scan_sock);
+  scan_sock = -1;
+
+  for (idx_t i = 0; i < scan_worker_count; i++)
+    {
+      int wait_status;
+      while (waitpid (scan_worker_pids[i], &wait_status, 0) < 0)
+	if (errno != EINTR)
+	  {
+	    waitpid_error (_("scan worker"));
+	    wait_status = 0;
+	    break;
+	  }
+      if (WIFSIGNALED (wait_status))
+	paxerror (0, _("Scan worker died with signal %d"),
+		  WTERMSIG (wait_status));
+    }
+
+  free (scan_worker_pids);
+  scan_worker_pids = NULL;
+  scan_worker_count = 0;
+}
+
+/* Pass the ENTRIES of the directory FD, in the format returned by
+   get_directory_entries, to the workers as requests of kind KIND.
+   This is only a hint: if the workers are lagging behind, the rest of
+   the entries are left to the main process.  */
+static void
+send_prefetch_request (char kind, int fd, char const *entries)
+{
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  char const *p = entries;
+
+  while (*p)
+    {
+      /* Collect as many names as fit in a message.  Names too long
+	 for a message on their own are skipped.  */
+      char const *start = p;
+      idx_t len;
+      while (*p
+	     && (len = strlen (p) + 1) <= SCAN_MESSAGE_SIZE - 1 - (p - start))
+	p += len;
+      if (p == start)
+	{
+	  p += len;
+	  continue;
+	}
+
+      struct iovec iov[2] = { { .iov_base = &kind, .iov_len = 1 },
+			      { .iov_base = (void *) start,
+				.iov_len = p - start } };
+      struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2,
+			    .msg_control = control.buf,
+			    .msg_controllen = sizeof control.buf };
+      struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN (sizeof fd);
+      memcpy (CMSG_DATA (cmsg), &fd, sizeof fd);
+
+      ssize_t sent;
+      while ((sent = sendmsg (scan_sock, &msg, MSG_DONTWAIT | MSG_NOSIGNAL))
+	     < 0)
+	if (errno != EINTR)
+	  return;
+    }
+}
+
+/* Have the workers read ahead the regular files among the ENTRIES of
+   the directory FD, in the format returned by get_directory_entries.  */
+void
+prefetch_files (int fd, char const *entries)
+{
+  if (0 <= scan_sock && 0 <= fd)
+    send_prefetch_request (PREFETCH_FILES, fd, entries);
+}
+
+/* Return the names in DUMP, in the format returned by
+   get_directory_entries.  */
+static char *
+dumpdir_entries (struct dumpdir const *dump)
+{
+  idx_t size = 1;
+  for (idx_t i = 0; i < dump->elc; i++)
+    size += strlen (dump->elv[i]) + 1;
+
+  char *entries = xmalloc (size);
+  char *p = entries;
+  for (idx_t i = 0; i < dump->elc; i++)
+    p = stpcpy (p, dump->elv[i]) + 1;
+  *p = '\0';
+  return entries;
+}
+
+/* Return true if the directory NAME, described by ST, is known from
+   the change journal to be unchanged since the last dump, so that its
+   entries can be taken from the snapshot file instead of being read
+   and examined.  */
+static bool
+directory_unchanged (char const *name, struct tar_stat_info const *st)
+{
+  if (!change_journal_option)
+    return false;
+  struct directory *d = find_directory (name);
+  return (d && d->dump && !dir_is_inited (d) && streq (d->name, name)
+	  && d->st_ino == st->stat.st_ino
+	  && (!check_device_option || d->st_dev == st->stat.st_dev)
+	  && timespec_cmp (d->mtime, get_stat_mtime (&st->stat)) == 0
+	  && change_journal_unchanged (d->caname));
+}
+
 /* Recursively scan the directory identified by ST.  */
 struct directory *
 scan_directory (struct tar_stat_info *st)
 {
   char const *dir = st->orig_file_name;
-  char *dirp = get_directory_entries (st);
+  char *tmp = xstrdup (dir);
+  zap_slashes (tmp);
+  bool unchanged = directory_unchanged (tmp, st);
+  char *dirp = (unchanged ? dumpdir_entries (find_directory (tmp)->dump)
+		: get_directory_entries (st));
   dev_t device = st->stat.st_dev;
   bool cmdline = ! st->parent;
   namebuf_t nbuf;
-  char *tmp;
   struct directory *directory;
   char ch;
 
@@ -789,15 +1112,27 @@ scan_directory (struct tar_stat_info *st)
 
   info_attach_exclist (st);
 
-  tmp = xstrdup (dir);
-  zap_slashes (tmp);
-
   directory = procdir (tmp, st,
 		       (cmdline ? PD_FORCE_INIT : 0),
 		       &ch);
 
   free (tmp);
 
+  if (unchanged
+      && (directory->children != CHANGED_CHILDREN || directory->orig
+	  || directory->tagfile))
+    {
+      /* The entries must be examined after all.  */
+      unchanged = false;
+      free (dirp);
+      dirp = get_directory_entries (st);
+      if (! dirp)
+	savedir_error (dir);
+    }
+
+  if (unchanged)
+    dir_set_flag (directory, DIRF_UNCHANGED);
+
   nbuf = namebuf_create (dir);
 
   if (dirp)
@@ -807,6 +1142,8 @@ scan_directory (struct tar_stat_info *st)
 	  char *entry;	/* directory entry being scanned */
 	  struct dumpdir_iter *itr;
 
+	  if (0 <= scan_sock && 0 <= st->fd && !unchanged)
+	    send_prefetch_request (PREFETCH_DIRECTORIES, st->fd, dirp);
 	  makedumpdir (directory, dirp);
 
 	  for (entry = dumpdir_first (directory->dump, true, &itr);
@@ -819,6 +1156,10 @@ scan_directory (struct tar_stat_info *st)
 		*entry = 'N';
 	      else if (excluded_name (full_name, st))
 		*entry = 'N';
+	      else if (unchanged
+		       && *dumpdir_locate (directory->idump, entry + 1) != 'D')
+		/* Only subdirectories need to be looked at.  */
+		*entry = 'N';
 	      else
 		{
 		  int fd = st->fd;
@@ -831,8 +1172,8 @@ scan_directory (struct tar_stat_info *st)
 		      errno = - fd;
 		      diag = open_diag;
 		    }
-		  else if (fstatat (fd, entry + 1, &stsub.stat,
-				    fstatat_flags)
+		  else if (stats_fstatat (fd, entry + 1, &stsub.stat,
+					  fstatat_flags)
 			   < 0)
 		    diag = stat_diag;
 		  else if (S_ISDIR (stsub.stat.st_mode))
@@ -909,6 +1250,14 @@ directory_contents (struct directory *dir)
   return dir->dump ? dir->dump->contents : NULL;
 }
 
+/* Return true if the entries of DIR were taken from the snapshot file
+   rather than read from the file system.  */
+bool
+directory_unread (struct directory const *dir)
+{
+  return !!(dir->flags & DIRF_UNCHANGED);
+}
+
 /* A "safe" version of directory_contents, which never returns NULL. */
 const char *
 safe_directory_contents (struct directory *dir)
@@ -1118,179 +1467,218 @@ read_incr_db_01 (bool version_1, char **pbuf, size_t *pbufsize)
     }
 }
 
-/* Read a nul-terminated string from FP and store it in STK.
-   Store the number of bytes read (including nul terminator) in PCOUNT.
+/* Reader for the null-terminated fields of snapshot format 2.  The
+   file is read in large chunks, records are located with memchr, and
+   their fields are used in place, as reading the file a byte at a
+   time is slow for snapshots of millions of directories.  */
+struct snapshot_reader
+{
+  FILE *fp;			/* Snapshot file */
+  char *buf;			/* Buffer */
+  idx_t size;			/* Size of BUF */
+  idx_t start;			/* Start of the current record in BUF */
+  idx_t end;			/* End of the data in BUF */
+  off_t offset;			/* File offset of BUF */
+  bool eof;			/* True if the end of file was reached */
+};
 
-   Return the last character read or EOF on end of file. */
-static int
-read_obstack (FILE *fp, struct obstack *stk, idx_t *pcount)
+enum { SNAPSHOT_CHUNK_SIZE = 1024 * 1024 };
+
+/* Read more of the snapshot file into the buffer of R, moving the
+   current record to its start.  */
+static void
+snapshot_fill (struct snapshot_reader *r)
 {
-  int c;
-  idx_t i;
+  if (r->start)
+    {
+      memmove (r->buf, r->buf + r->start, r->end - r->start);
+      r->offset += r->start;
+      r->end -= r->start;
+      r->start = 0;
+    }
+  if (r->size - r->end < SNAPSHOT_CHUNK_SIZE / 2)
+    r->buf = xpalloc (r->buf, &r->size,
+		      SNAPSHOT_CHUNK_SIZE - (r->size - r->end), -1, 1);
 
-  for (i = 0; 0 < (c = getc (fp)); i++)
-    obstack_1grow (stk, c);
-  obstack_1grow (stk, 0);
+  size_t n = fread (r->buf + r->end, 1, r->size - r->end, r->fp);
+  if (n == 0)
+    {
+      if (ferror (r->fp))
+	read_fatal (listed_incremental_option);
+      r->eof = true;
+    }
+  r->end += n;
+}
 
-  *pcount = i;
-  return c;
+/* Return the position of the null byte ending the field that starts
+   at position POS of the current record of R, or -1 if the file ends
+   before it.  Positions are relative to the start of the record, as
+   the record may move in the buffer.  */
+static idx_t
+snapshot_field_end (struct snapshot_reader *r, idx_t pos)
+{
+  for (;;)
+    {
+      idx_t avail = r->end - r->start - pos;
+      if (0 < avail)
+	{
+	  char *p = r->buf + r->start + pos;
+	  char *q = memchr (p, 0, avail);
+	  if (q)
+	    return q - (r->buf + r->start);
+	}
+      if (r->eof)
+	return -1;
+      snapshot_fill (r);
+    }
 }
 
-/* Read from file FP a null-terminated string and convert it to an
-   integer.  FIELDNAME is the intended use of the integer, useful for
-   diagnostics.  MIN_VAL and MAX_VAL are its minimum and maximum
-   permissible values; MIN_VAL must be nonpositive and MAX_VAL positive.
-   Store into *PVAL the resulting value, converted to intmax_t.
+static _Noreturn void
+snapshot_eof (void)
+{
+  paxfatal (0, "%s: %s", quotearg_colon (listed_incremental_option),
+	    _("Unexpected EOF in snapshot file"));
+}
 
-   Throw a fatal error if the string cannot be converted or if the
-   converted value is out of range.
+/* Convert to an integer the field at position POS of the current
+   record of R.  FIELDNAME is the intended use of the integer, useful
+   for diagnostics.  MIN_VAL and MAX_VAL are its minimum and maximum
+   permissible values; MIN_VAL must be nonpositive and MAX_VAL positive.
+   Return the resulting value, converted to intmax_t, and store in *PEND
+   the position of the null byte ending the field.
 
-   Return true if successful, false if end of file.  */
+   Throw a fatal error if the field is missing, if it cannot be
+   converted, or if the converted value is out of range.  */
 
-static bool
-read_num (FILE *fp, char const *fieldname,
-	  intmax_t min_val, uintmax_t max_val, intmax_t *pval)
+static intmax_t
+snapshot_num (struct snapshot_reader *r, idx_t pos, idx_t *pend,
+	      char const *fieldname, intmax_t min_val, uintmax_t max_val)
 {
-  int i;
-  char buf[INT_BUFSIZE_BOUND (intmax_t)];
-  int c = getc (fp);
-  bool negative = c == '-';
-
-  for (i = 0; (i == 0 && negative) || c_isdigit (c); i++)
-    {
-      buf[i] = c;
-      if (i == sizeof buf - 1)
-	paxfatal (0,
-		  _("%s: byte %jd: %s %.*s... too long"),
-		  quotearg_colon (listed_incremental_option),
-		  intmax (ftello (fp)),
-		  fieldname, i + 1, buf);
-      c = getc (fp);
-    }
-
-  buf[i] = 0;
+  idx_t end = snapshot_field_end (r, pos);
+  if (end < 0)
+    snapshot_eof ();
 
-  if (c < 0)
-    {
-      if (ferror (fp))
-	read_fatal (listed_incremental_option);
-      if (i != 0)
-	paxfatal (0, "%s: %s",
-		  quotearg_colon (listed_incremental_option),
-		  _("Unexpected EOF in snapshot file"));
-      return false;
-    }
+  char const *str = r->buf + r->start + pos;
+  off_t offset = r->offset + r->start + pos;
+  idx_t i;
+  for (i = str[0] == '-'; c_isdigit (str[i]); i++)
+    if (i == INT_BUFSIZE_BOUND (intmax_t) - 1)
+      paxfatal (0,
+		_("%s: byte %jd: %s %.*s... too long"),
+		quotearg_colon (listed_incremental_option),
+		intmax (offset + i + 1), fieldname, (int) i + 1, str);
 
-  if (c)
+  if (str[i])
     {
-      unsigned uc = c;
-      paxfatal (0, _("%s: byte %jd: %s %s followed by invalid byte 0x%02x"),
+      unsigned uc = (unsigned char) str[i];
+      paxfatal (0, _("%s: byte %jd: %s %.*s followed by invalid byte 0x%02x"),
 		quotearg_colon (listed_incremental_option),
-		intmax (ftello (fp)), fieldname, buf, uc);
+		intmax (offset + i + 1), fieldname, (int) i, str, uc);
     }
 
-  char *bufend;
+  char *strend;
   bool overflow;
-  *pval = stoint (buf, &bufend, &overflow, min_val, max_val);
+  intmax_t val = stoint (str, &strend, &overflow, min_val, max_val);
 
-  if (buf == bufend)
+  if (str == strend)
     paxfatal (EINVAL, _("%s: byte %jd: %s %s"),
 	      quotearg_colon (listed_incremental_option),
-	      intmax (ftello (fp)), fieldname, buf);
+	      intmax (offset + i + 1), fieldname, str);
   if (overflow)
     paxfatal (ERANGE, _("%s: byte %jd: (valid range %jd..%ju)\n\t%s %s"),
 	      quotearg_colon (listed_incremental_option),
-	      intmax (ftello (fp)), min_val, max_val, fieldname, buf);
+	      intmax (offset + i + 1), min_val, max_val, fieldname, str);
 
-  return true;
+  *pend = end;
+  return val;
 }
 
-/* Read from FP two NUL-terminated strings representing a struct
-   timespec.  Return the resulting value in PVAL.
+/* Convert the two fields at position POS of the current record of R
+   to a struct timespec.  Return the resulting value in PVAL, and store
+   in *PEND the position of the null byte ending the second field.
 
-   Throw a fatal error if the string cannot be converted.  */
+   Throw a fatal error if the fields cannot be converted.  */
 
 static void
-read_timespec (FILE *fp, struct timespec *pval)
+snapshot_timespec (struct snapshot_reader *r, idx_t pos, idx_t *pend,
+		   struct timespec *pval)
 {
-  intmax_t s, ns;
-
-  if (read_num (fp, "sec", TYPE_MINIMUM (time_t), TYPE_MAXIMUM (time_t), &s)
-      && read_num (fp, "nsec", 0, BILLION - 1, &ns))
-    {
-      pval->tv_sec = s;
-      pval->tv_nsec = ns;
-    }
-  else
-    {
-      paxfatal (0, "%s: %s", quotearg_colon (listed_incremental_option),
-		_("Unexpected EOF in snapshot file"));
-    }
+  pval->tv_sec = snapshot_num (r, pos, &pos, "sec",
+			       TYPE_MINIMUM (time_t), TYPE_MAXIMUM (time_t));
+  pval->tv_nsec = snapshot_num (r, pos + 1, pend, "nsec", 0, BILLION - 1);
 }
 
 /* Read incremental snapshot format 2 */
 static void
 read_incr_db_2 (void)
 {
-  struct obstack stk;
-  char offbuf[INT_BUFSIZE_BOUND (off_t)];
+  struct snapshot_reader r = { .fp = listed_incremental_stream };
+  idx_t pos;
 
-  obstack_init (&stk);
+  r.offset = ftello (r.fp);
+  if (r.offset < 0)
+    r.offset = 0;
 
-  read_timespec (listed_incremental_stream, &newer_mtime_option);
+  snapshot_timespec (&r, 0, &pos, &newer_mtime_option);
+  r.start += pos + 1;
 
   for (;;)
     {
-      intmax_t i;
       struct timespec mtime;
       dev_t dev;
       ino_t ino;
       bool nfs;
-      char *name;
-      char *content;
-      idx_t s;
-
-      if (! read_num (listed_incremental_stream, "nfs", 0, 1, &i))
-	return; /* Normal return */
-
-      nfs = i;
-
-      read_timespec (listed_incremental_stream, &mtime);
-
-      if (! read_num (listed_incremental_stream, "dev",
-		      TYPE_MINIMUM (dev_t), TYPE_MAXIMUM (dev_t), &i))
-	break;
-      dev = i;
 
-      if (! read_num (listed_incremental_stream, "ino",
-		      TYPE_MINIMUM (ino_t), TYPE_MAXIMUM (ino_t), &i))
-	break;
-      ino = i;
-
-      if (read_obstack (listed_incremental_stream, &stk, &s) != 0)
-	break;
-
-      name = obstack_finish (&stk);
+      /* Normal return */
+      if (r.start == r.end)
+	{
+	  if (!r.eof)
+	    snapshot_fill (&r);
+	  if (r.start == r.end)
+	    break;
+	}
 
-      while (read_obstack (listed_incremental_stream, &stk, &s) == 0 && s > 1)
-	;
-      if (getc (listed_incremental_stream) != 0)
-	paxfatal (0, _("%s: byte %s: %s"),
+      nfs = snapshot_num (&r, 0, &pos, "nfs", 0, 1);
+      snapshot_timespec (&r, pos + 1, &pos, &mtime);
+      dev = snapshot_num (&r, pos + 1, &pos, "dev",
+			  TYPE_MINIMUM (dev_t), TYPE_MAXIMUM (dev_t));
+      ino = snapshot_num (&r, pos + 1, &pos, "ino",
+			  TYPE_MINIMUM (ino_t), TYPE_MAXIMUM (ino_t));
+
+      idx_t name = pos + 1;
+      idx_t content = snapshot_field_end (&r, name);
+      if (content < 0)
+	snapshot_eof ();
+      content++;
+
+      /* The contents end with an entry of at most one byte, normally an
+	 empty one, which is followed by the record terminator.  */
+      idx_t end;
+      for (pos = content; ; pos = end + 1)
+	{
+	  end = snapshot_field_end (&r, pos);
+	  if (end < 0)
+	    snapshot_eof ();
+	  if (end - pos <= 1)
+	    break;
+	}
+      if (snapshot_field_end (&r, end + 1) != end + 1)
+	paxfatal (0, _("%s: byte %jd: %s"),
 		  quotearg_colon (listed_incremental_option),
-		  offtostr (ftello (listed_incremental_stream), offbuf),
+		  intmax (r.offset + r.start + end + 2),
 		  _("Missing record terminator"));
 
-      content = obstack_finish (&stk);
-      note_directory (name, mtime, dev, ino, nfs, false, content);
-      obstack_free (&stk, content);
+      char *rec = r.buf + r.start;
+      note_directory (rec + name, mtime, dev, ino, nfs, false, rec + content);
+      r.start += end + 2;
     }
-  paxfatal (0, "%s: %s", quotearg_colon (listed_incremental_option),
-	    _("Unexpected EOF in snapshot file"));
+
+  free (r.buf);
 }
 
 /* Display (to stdout) the range of allowed values for each field
    in the snapshot file.  The array below should be kept in sync
-   with any changes made to the read_num() calls in the parsing
+   with any changes made to the snapshot_num() calls in the parsing
    loop inside read_incr_db_2().
 
    (This function is invoked via the --show-snapshot-field-ranges
@@ -0,0 +1,871 @@
+/* Change journals for incremental dumps.
+
+   Copyright 2026 Free Software Foundation, Inc.
+
+   This file is part of GNU tar.
+
+   GNU tar is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU tar is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <system.h>
+#include <hash.h>
+#include <quotearg.h>
+#include "common.h"
+
+#if HAVE_SYS_INOTIFY_H
+# include <poll.h>
+# include <sys/inotify.h>
+#endif
+
+/* A change journal is written by 'tar --watch-changes', which runs
+   for as long as the journal is to be kept up to date, and holds a
+   lock on it in the meantime.  The journal starts with the line
+
+     GNU tar-VERSION-journal-FORMAT
+
+   which is followed by records made of null-terminated fields.  The
+   first field of each record is a single letter giving its type, and
+   the next two are a time stamp, in seconds and nanoseconds:
+
+     S SEC NSEC       Recording started.  Changes made since SEC.NSEC
+		      in the directories that follow are recorded.
+     R SEC NSEC NAME  NAME is one of these directories.
+     C SEC NSEC NAME  The directory NAME or a file in it has changed at
+		      some time before SEC.NSEC.
+     O SEC NSEC       Changes made before SEC.NSEC may have been lost.
+     H SEC NSEC       All changes made before SEC.NSEC are recorded.
+
+   The directory names are absolute and canonical, as returned by
+   normalize_filename.
+
+   A dump reading the journal first updates the time stamp of the
+   journal, and waits for the 'H' record the recorder writes in
+   response.  To keep the journal small, a directory that changes again
+   less than CHANGE_JOURNAL_WINDOW seconds after its last 'C' record is
+   not recorded again.  A dump therefore takes as changed the
+   directories recorded up to that long before the dump described by
+   the snapshot file started.
+
+   After answering a request, the recorder rewrites the journal once it
+   has grown to twice its size when last rewritten.  The new journal
+   holds only the 'S' and 'R' records, the last 'O' record, and the
+   last 'C' record of each directory, which tell any dump the same as
+   the full journal.  It is written to a temporary file that then
+   replaces the journal, so a dump reading the old file reads it anew
+   if it finds it replaced.  */
+
+enum { CHANGE_JOURNAL_VERSION = 1 };
+
+/* Seconds to wait for the recorder to respond.  */
+enum { CHANGE_JOURNAL_TIMEOUT = 30 };
+
+/* Seconds during which further changes to a directory recorded as
+   changed are not recorded.  */
+enum { CHANGE_JOURNAL_WINDOW = 1 };
+
+/* Size below which the journal is not rewritten.  */
+enum { CHANGE_JOURNAL_COMPACT_MIN = 64 * 1024 };
+
+static size_t
+hash_string_entry (void const *entry, size_t n_buckets)
+{
+  return hash_string (entry, n_buckets);
+}
+
+static bool
+compare_string_entries (void const *a, void const *b)
+{
+  return streq (a, b);
+}
+
+/* Return a new hash table of strings, which it owns.  */
+static Hash_table *
+make_string_table (void)
+{
+  Hash_table *t = hash_initialize (0, NULL, hash_string_entry,
+				   compare_string_entries, free);
+  if (!t)
+    xalloc_die ();
+  return t;
+}
+
+/* Add a copy of STRING to the hash table T, if it is not there yet.
+   Return true if it was added.  */
+static bool
+add_string (Hash_table *t, char const *string)
+{
+  if (hash_lookup (t, string))
+    return false;
+  if (!hash_insert (t, xstrdup (string)))
+    xalloc_die ();
+  return true;
+}
+
+/* Reading the journal.  */
+
+/* Directories whose changes were recorded since the last dump.  */
+static Hash_table *changed_table;
+
+/* Directories being watched by the recorder.  */
+static char **journal_roots;
+static idx_t journal_root_count;
+static idx_t journal_root_alloc;
+
+/* Changes made since this time are recorded.  */
+static struct timespec journal_trusted;
+
+/* Directories recorded since this time have changed since the last
+   dump.  */
+static struct timespec journal_since;
+
+/* True if recording has started, and if it is up to date.  */
+static bool journal_started;
+static bool journal_synced;
+
+/* Time of the request sent to the recorder.  */
+static struct timespec journal_request;
+
+/* True if the journal is to be used.  */
+static bool journal_usable;
+
+static void
+journal_unusable (int errnum, char const *reason)
+{
+  paxwarn (errnum, _("%s: %s; scanning all directories"),
+	   quotearg_colon (change_journal_option), reason);
+}
+
+/* Read a null-terminated field from FP into *PBUF, which has size
+   *PSIZE.  Return false on end of file, error, or if the field is
+   not complete yet.  */
+static bool
+read_journal_field (FILE *fp, char **pbuf, size_t *psize)
+{
+  ssize_t n = getdelim (pbuf, psize, 0, fp);
+  return 0 < n && !(*pbuf)[n - 1];
+}
+
+static bool
+read_journal_time (FILE *fp, char **pbuf, size_t *psize, struct timespec *t)
+{
+  char *end;
+  bool overflow;
+
+  if (!read_journal_field (fp, pbuf, psize))
+    return false;
+  t->tv_sec = stoint (*pbuf, &end, &overflow,
+		      TYPE_MINIMUM (time_t), TYPE_MAXIMUM (time_t));
+  if (end == *pbuf || *end || overflow
+      || !read_journal_field (fp, pbuf, psize))
+    return false;
+  t->tv_nsec = stoint (*pbuf, &end, &overflow, 0, BILLION - 1);
+  return end != *pbuf && !*end && !overflow;
+}
+
+static void
+clear_journal_roots (void)
+{
+  for (idx_t i = 0; i < journal_root_count; i++)
+    free (journal_roots[i]);
+  journal_root_count = 0;
+}
+
+/* Read the next record from FP, using the buffer *PBUF of size
+   *PSIZE.  Return 1 if successful, 0 if the record is not complete
+   yet, and -1 if it is invalid.  */
+static int
+read_journal_record (FILE *fp, char **pbuf, size_t *psize)
+{
+  struct timespec t;
+  char type;
+
+  if (! (read_journal_field (fp, pbuf, psize)
+	 && (type = (*pbuf)[0]) && !(*pbuf)[1]
+	 && read_journal_time (fp, pbuf, psize, &t)))
+    return feof (fp) ? 0 : -1;
+
+  switch (type)
+    {
+    case 'S':
+      clear_journal_roots ();
+      journal_trusted = t;
+      journal_started = true;
+      break;
+
+    case 'O':
+      if (timespec_cmp (journal_trusted, t) < 0)
+	journal_trusted = t;
+      break;
+
+    case 'H':
+      if (0 <= timespec_cmp (t, journal_request))
+	journal_synced = true;
+      break;
+
+    case 'R':
+    case 'C':
+      if (!read_journal_field (fp, pbuf, psize))
+	return feof (fp) ? 0 : -1;
+      if (type == 'C')
+	{
+	  if (0 <= timespec_cmp (t, journal_since))
+	    add_string (changed_table, *pbuf);
+	}
+      else
+	{
+	  if (journal_root_count == journal_root_alloc)
+	    journal_roots = xpalloc (journal_roots, &journal_root_alloc, 1, -1,
+				     sizeof *journal_roots);
+	  journal_roots[journal_root_count++] = xstrdup (*pbuf);
+	}
+      break;
+
+    default:
+      return -1;
+    }
+  return 1;
+}
+
+/* Return true if the change journal file has been replaced by
+   another file since it was opened as FD.  */
+static bool
+journal_replaced (int fd)
+{
+  struct stat st1, st2;
+  return (fstat (fd, &st1) == 0 && stat (change_journal_option, &st2) == 0
+	  && !psame_inode (&st1, &st2));
+}
+
+/* Read the change journal.  Return false if the recorder has rewritten
+   it in the meantime, so that it must be read anew.  */
+static bool
+read_change_journal (void)
+{
+  int fd = open (change_journal_option, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    {
+      journal_unusable (errno, _("Cannot open change journal"));
+      return true;
+    }
+
+  struct flock lock = { .l_type = F_RDLCK, .l_whence = SEEK_SET };
+  if (fcntl (fd, F_GETLK, &lock) < 0 || lock.l_type == F_UNLCK)
+    {
+      bool replaced = journal_replaced (fd);
+      if (!replaced)
+	journal_unusable (0, _("Changes are not being recorded"));
+      close (fd);
+      return !replaced;
+    }
+
+  /* Ask the recorder to catch up with the changes made so far.  */
+  journal_request = current_timespec ();
+  if (futimens (fd, NULL) < 0)
+    {
+      journal_unusable (errno, _("Cannot update the change journal"));
+      close (fd);
+      return true;
+    }
+
+  FILE *fp = fdopen (fd, "r");
+  if (!fp)
+    xalloc_die ();
+
+  char *buf = NULL;
+  size_t bufsize = 0;
+  static char const magic[] = PACKAGE_NAME "-";
+  char *p;
+  bool replaced = false;
+
+  if (getline (&buf, &bufsize, fp) <= 0
+      || strncmp (buf, magic, sizeof magic - 1) != 0
+      || ! (p = strstr (buf, "-journal-"))
+      || stoint (p + sizeof "-journal-" - 1, &p, NULL, 0, INT_MAX)
+	 != CHANGE_JOURNAL_VERSION
+      || !streq (p, "\n"))
+    journal_unusable (0, _("Invalid change journal"));
+  else
+    for (;;)
+      {
+	off_t start = ftello (fp);
+	int r = read_journal_record (fp, &buf, &bufsize);
+	if (r < 0)
+	  {
+	    journal_unusable (0, _("Invalid change journal"));
+	    break;
+	  }
+	if (journal_synced)
+	  {
+	    /* A level 0 dump has no use for the changes.  */
+	    if (!time_option_initialized (newer_mtime_option))
+	      break;
+	    if (! (journal_started
+		   && timespec_cmp (journal_trusted, newer_mtime_option) <= 0))
+	      journal_unusable (0, _("Changes since the last dump"
+				     " were not all recorded"));
+	    else
+	      journal_usable = true;
+	    break;
+	  }
+	if (r == 0)
+	  {
+	    /* The request may have reached the recorder after it
+	       rewrote the journal, in which case it answers in the new
+	       file.  */
+	    replaced = journal_replaced (fd);
+	    if (replaced)
+	      break;
+
+	    /* Wait for the recorder to write more.  */
+	    if (CHANGE_JOURNAL_TIMEOUT
+		< current_timespec ().tv_sec - journal_request.tv_sec)
+	      {
+		journal_unusable (0, _("Change recorder does not respond"));
+		break;
+	      }
+	    clearerr (fp);
+	    if (fseeko (fp, start, SEEK_SET) < 0)
+	      {
+		journal_unusable (errno, _("Cannot read change journal"));
+		break;
+	      }
+	    nanosleep (&(struct timespec) { .tv_nsec = BILLION / 10 }, NULL);
+	  }
+      }
+
+  free (buf);
+  fclose (fp);
+  return !replaced;
+}
+
+/* Read the change journal, if one was given, to find the directories
+   that changed since the dump described by the snapshot file.  This
+   must be called after the snapshot file has been read.  */
+void
+change_journal_read (void)
+{
+  if (! (change_journal_option && listed_incremental_option))
+    return;
+
+  /* A level 0 dump does not use the journal, but it still sends a
+     request, so that it warns if changes are not being recorded.  */
+  journal_since = newer_mtime_option;
+  journal_since.tv_sec -= CHANGE_JOURNAL_WINDOW;
+  changed_table = make_string_table ();
+  while (!read_change_journal ())
+    {
+      clear_journal_roots ();
+      hash_clear (changed_table);
+      journal_started = journal_synced = false;
+    }
+}
+
+/* Return true if the change journal shows that neither the directory
+   with the canonical name CANAME nor the files in it have changed
+   since the last dump.  */
+bool
+change_journal_unchanged (char const *caname)
+{
+  if (!journal_usable || hash_lookup (changed_table, caname))
+    return false;
+
+  for (idx_t i = 0; i < journal_root_count; i++)
+    {
+      char const *root = journal_roots[i];
+      idx_t len = strlen (root);
+      if (strncmp (caname, root, len) == 0
+	  && (!caname[len] || ISSLASH (caname[len]) || ISSLASH (root[len - 1])))
+	return true;
+    }
+  return false;
+}
+
+/* Recording changes.  */
+
+#if HAVE_SYS_INOTIFY_H
+
+enum
+  {
+    WATCH_MASK = (IN_ATTRIB | IN_CREATE | IN_DELETE | IN_DELETE_SELF
+		  | IN_MODIFY | IN_MOVED_FROM | IN_MOVED_TO
+		  | IN_DONT_FOLLOW | IN_EXCL_UNLINK | IN_ONLYDIR)
+  };
+
+/* A watched directory.  */
+struct watch
+{
+  int wd;			/* Watch descriptor */
+  char *name;			/* Canonical name of the directory */
+};
+
+static int inotify_fd;
+
+/* Watch descriptor of the journal itself.  */
+static int journal_wd;
+
+/* Descriptor the journal is written to.  */
+static int journal_fd;
+
+/* Records not yet written to the journal.  */
+static struct obstack journal_stk;
+
+/* Watched directories, by watch descriptor.  */
+static Hash_table *watch_table;
+
+/* A directory recorded as changed, and the time stamp of its last
+   record.  */
+struct change
+{
+  char *name;
+  struct timespec time;
+};
+
+/* Directories recorded since recording started.  */
+static Hash_table *change_table;
+
+/* Directories being watched, as given in the command line.  */
+static Hash_table *root_table;
+
+/* Time recording started, and time changes were last lost, if
+   JOURNAL_LOST.  */
+static struct timespec journal_start;
+static struct timespec journal_loss;
+static bool journal_lost;
+
+/* Size of the journal, and its size when last rewritten.  */
+static off_t journal_size;
+static off_t journal_compacted_size;
+
+static size_t
+hash_watch (void const *entry, size_t n_buckets)
+{
+  struct watch const *w = entry;
+  return (unsigned) w->wd % n_buckets;
+}
+
+static bool
+compare_watches (void const *a, void const *b)
+{
+  struct watch const *w1 = a;
+  struct watch const *w2 = b;
+  return w1->wd == w2->wd;
+}
+
+static void
+free_watch (void *entry)
+{
+  struct watch *w = entry;
+  free (w->name);
+  free (w);
+}
+
+static size_t
+hash_change (void const *entry, size_t n_buckets)
+{
+  struct change const *c = entry;
+  return hash_string (c->name, n_buckets);
+}
+
+static bool
+compare_changes (void const *a, void const *b)
+{
+  struct change const *c1 = a;
+  struct change const *c2 = b;
+  return streq (c1->name, c2->name);
+}
+
+static void
+free_change (void *entry)
+{
+  struct change *c = entry;
+  free (c->name);
+  free (c);
+}
+
+static struct watch *
+find_watch (int wd)
+{
+  return hash_lookup (watch_table, &(struct watch) { .wd = wd });
+}
+
+static void
+add_journal_number (intmax_t n)
+{
+  char buf[INT_BUFSIZE_BOUND (intmax_t)];
+  obstack_grow0 (&journal_stk, buf, sprintf (buf, "%jd", n));
+}
+
+/* Add a record of type TYPE to the journal, with the time stamp T and,
+   unless it is null, NAME.  */
+static void
+add_journal_record (char type, struct timespec t, char const *name)
+{
+  obstack_1grow (&journal_stk, type);
+  obstack_1grow (&journal_stk, 0);
+  add_journal_number (t.tv_sec);
+  add_journal_number (t.tv_nsec);
+  if (name)
+    obstack_grow0 (&journal_stk, name, strlen (name));
+}
+
+/* Add the line that starts the journal.  */
+static void
+add_journal_header (void)
+{
+  char header[sizeof PACKAGE_NAME + sizeof PACKAGE_VERSION
+	      + sizeof "-journal-\n" + INT_STRLEN_BOUND (int)];
+  obstack_grow (&journal_stk, header,
+		sprintf (header, "%s-%s-journal-%d\n",
+			 PACKAGE_NAME, PACKAGE_VERSION,
+			 CHANGE_JOURNAL_VERSION));
+}
+
+/* Add the records telling that recording started.  */
+static void
+add_journal_start (void)
+{
+  add_journal_record ('S', journal_start, NULL);
+  for (char *root = hash_get_first (root_table); root;
+       root = hash_get_next (root_table, root))
+    add_journal_record ('R', journal_start, root);
+}
+
+/* Write the pending records, at once so that a reader sees either all
+   of a record or none of it.  */
+static void
+flush_journal (void)
+{
+  idx_t size = obstack_object_size (&journal_stk);
+  char *records = obstack_finish (&journal_stk);
+  if (full_write (journal_fd, records, size) != size)
+    write_fatal (change_journal_option);
+  journal_size += size;
+  obstack_free (&journal_stk, records);
+}
+
+/* Replace the journal with a new one, holding only the records a
+   dump needs.  On failure, warn and go on appending to the old one.  */
+static void
+compact_journal (void)
+{
+  char *tmp = xasprintf ("%s.tmp", change_journal_option);
+  int fd = open (tmp, O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC,
+		 MODE_RW);
+  int wd = -1;
+  struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+  bool ok = 0 <= fd && fcntl (fd, F_SETLK, &lock) == 0;
+
+  if (ok)
+    {
+      add_journal_header ();
+      add_journal_start ();
+      if (journal_lost)
+	add_journal_record ('O', journal_loss, NULL);
+      for (struct change *c = hash_get_first (change_table); c;
+	   c = hash_get_next (change_table, c))
+	add_journal_record ('C', c->time, c->name);
+      idx_t size = obstack_object_size (&journal_stk);
+      char *records = obstack_finish (&journal_stk);
+      ok = full_write (fd, records, size) == size;
+      obstack_free (&journal_stk, records);
+
+      /* Watch the new journal before it is in place, so that no
+	 request can be missed.  */
+      ok = (ok
+	    && 0 <= (wd = inotify_add_watch (inotify_fd, tmp, IN_ATTRIB))
+	    && rename (tmp, change_journal_option) == 0);
+      if (ok)
+	{
+	  inotify_rm_watch (inotify_fd, journal_wd);
+	  close (journal_fd);
+	  journal_fd = fd;
+	  journal_wd = wd;
+	  journal_size = size;
+	}
+    }
+
+  if (!ok)
+    {
+      paxwarn (errno, _("%s: Cannot rewrite change journal"),
+	       quotearg_colon (change_journal_option));
+      if (0 <= wd)
+	inotify_rm_watch (inotify_fd, wd);
+      if (0 <= fd)
+	{
+	  close (fd);
+	  unlink (tmp);
+	}
+    }
+  journal_compacted_size = journal_size;
+  free (tmp);
+}
+
+/* Record that the directory NAME, or a file in it, has changed.  */
+static void
+record_change (char const *name)
+{
+  struct timespec t = current_timespec ();
+  struct change *c = hash_lookup (change_table,
+				  &(struct change) { .name = (char *) name });
+  if (c)
+    {
+      struct timespec until = c->time;
+      until.tv_sec += CHANGE_JOURNAL_WINDOW;
+      if (timespec_cmp (t, until) < 0)
+	return;
+    }
+  else
+    {
+      c = xmalloc (sizeof *c);
+      c->name = xstrdup (name);
+      if (!hash_insert (change_table, c))
+	xalloc_die ();
+    }
+  add_journal_record ('C', t, name);
+  c->time = t;
+}
+
+/* Record that changes may have been lost.  */
+static void
+record_loss (void)
+{
+  journal_loss = current_timespec ();
+  journal_lost = true;
+  add_journal_record ('O', journal_loss, NULL);
+}
+
+/* Watch the directory NAME and the directories below it.  If RECORD,
+   also record them as changed, as they may have changed before the
+   watches were in place.  If INITIAL, failures are fatal.  */
+static void
+watch_tree (char const *name, bool record, bool initial)
+{
+  char **pending = xmalloc (sizeof *pending);
+  idx_t pending_count = 1;
+  idx_t pending_alloc = 1;
+
+  pending[0] = xstrdup (name);
+  while (pending_count)
+    {
+      char *dir = pending[--pending_count];
+      int wd = inotify_add_watch (inotify_fd, dir, WATCH_MASK);
+      if (wd < 0)
+	{
+	  /* A directory that has disappeared needs no watching.  */
+	  if (! (errno == ENOENT || errno == ENOTDIR || errno == ELOOP))
+	    {
+	      if (initial)
+		paxfatal (errno, _("%s: Cannot watch directory"),
+			  quotearg_colon (dir));
+	      paxwarn (errno, _("%s: Cannot watch directory"),
+		       quotearg_colon (dir));
+	      record_loss ();
+	    }
+	  free (dir);
+	  continue;
+	}
+
+      struct watch *w = find_watch (wd);
+      if (w)
+	{
+	  /* The directory was renamed.  */
+	  free (w->name);
+	  w->name = dir;
+	}
+      else
+	{
+	  w = xmalloc (sizeof *w);
+	  w->wd = wd;
+	  w->name = dir;
+	  if (!hash_insert (watch_table, w))
+	    xalloc_die ();
+	}
+      if (record)
+	record_change (dir);
+
+      int fd = open (dir, (O_RDONLY | O_BINARY | O_CLOEXEC | O_DIRECTORY
+			   | O_NOFOLLOW));
+      DIR *dirp = fd < 0 ? NULL : fdopendir (fd);
+      if (!dirp)
+	{
+	  if (0 <= fd)
+	    close (fd);
+	  continue;
+	}
+      struct dirent *ent;
+      while ((ent = readdir (dirp)))
+	{
+	  char const *d = ent->d_name;
+	  if (d[0] == '.' && (!d[1] || (d[1] == '.' && !d[2])))
+	    continue;
+#ifdef _DIRENT_HAVE_D_TYPE
+	  if (ent->d_type != DT_DIR && ent->d_type != DT_UNKNOWN)
+	    continue;
+#endif
+	  struct stat st;
+	  if (fstatat (fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0
+	      && S_ISDIR (st.st_mode))
+	    {
+	      if (pending_count == pending_alloc)
+		pending = xpalloc (pending, &pending_alloc, 1, -1,
+				   sizeof *pending);
+	      pending[pending_count++] = make_file_name (dir, ent->d_name);
+	    }
+	}
+      closedir (dirp);
+    }
+  free (pending);
+}
+
+/* Read and record the changes reported so far.  Return true if a dump
+   has asked for the journal to be brought up to date.  */
+static bool
+read_changes (void)
+{
+  union
+  {
+    char buf[64 * 1024];
+    struct inotify_event align;
+  } u;
+  bool requested = false;
+  ssize_t n;
+
+  while ((n = read (inotify_fd, u.buf, sizeof u.buf)) != 0)
+    {
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  if (errno == EAGAIN || errno == EWOULDBLOCK)
+	    break;
+	  read_fatal (change_journal_option);
+	}
+
+      struct inotify_event const *ev;
+      for (char const *p = u.buf; p < u.buf + n; p += sizeof *ev + ev->len)
+	{
+	  ev = (struct inotify_event const *) p;
+	  if (ev->mask & IN_Q_OVERFLOW)
+	    record_loss ();
+	  else if (ev->wd == journal_wd)
+	    requested |= !! (ev->mask & IN_ATTRIB);
+	  else
+	    {
+	      struct watch *w = find_watch (ev->wd);
+	      if (!w)
+		continue;
+	      if (ev->mask & IN_IGNORED)
+		{
+		  hash_remove (watch_table, w);
+		  free_watch (w);
+		  continue;
+		}
+	      record_change (w->name);
+	      if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+		{
+		  char *sub = make_file_name (w->name, ev->name);
+		  watch_tree (sub, true, false);
+		  free (sub);
+		}
+	    }
+	}
+    }
+  return requested;
+}
+#endif
+
+/* Record the directories that change below the directories given in
+   the command line, until killed.  */
+void
+watch_changes (void)
+{
+#if HAVE_SYS_INOTIFY_H
+  journal_fd = open (change_journal_option,
+		     O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, MODE_RW);
+  if (journal_fd < 0)
+    open_fatal (change_journal_option);
+
+  struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+  if (fcntl (journal_fd, F_SETLK, &lock) < 0)
+    paxfatal (errno, _("%s: Cannot lock change journal"),
+	      quotearg_colon (change_journal_option));
+
+  struct stat st;
+  if (fstat (journal_fd, &st) < 0)
+    stat_fatal (change_journal_option);
+
+  obstack_init (&journal_stk);
+  journal_size = st.st_size;
+  if (journal_size == 0)
+    add_journal_header ();
+
+  inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd < 0)
+    paxfatal (errno, _("Cannot watch for changes"));
+  journal_wd = inotify_add_watch (inotify_fd, change_journal_option,
+				  IN_ATTRIB);
+  if (journal_wd < 0)
+    paxfatal (errno, _("%s: Cannot watch change journal"),
+	      quotearg_colon (change_journal_option));
+
+  watch_table = hash_initialize (0, NULL, hash_watch, compare_watches,
+				 free_watch);
+  if (!watch_table)
+    xalloc_die ();
+  change_table = hash_initialize (0, NULL, hash_change, compare_changes,
+				  free_change);
+  if (!change_table)
+    xalloc_die ();
+
+  /* Watch the directories before recording the start time, so that
+     no change made after that time can be missed.  */
+  char const *name;
+  root_table = make_string_table ();
+  while ((name = name_next (true)))
+    {
+      char *root = normalize_filename (chdir_current, name);
+      watch_tree (root, false, true);
+      add_string (root_table, root);
+      free (root);
+    }
+  journal_start = current_timespec ();
+  add_journal_start ();
+  flush_journal ();
+
+  for (;;)
+    {
+      struct pollfd pfd = { .fd = inotify_fd, .events = POLLIN };
+      if (poll (&pfd, 1, -1) < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  paxfatal (errno, _("Cannot watch for changes"));
+	}
+      bool requested = read_changes ();
+      if (requested)
+	{
+	  /* Every change made before T has been reported by now, or
+	     will be by the time the queue has been emptied.  */
+	  struct timespec t = current_timespec ();
+	  read_changes ();
+	  add_journal_record ('H', t, NULL);
+	}
+      flush_journal ();
+      if (requested && CHANGE_JOURNAL_COMPACT_MIN <= journal_size
+	  && journal_compacted_size < journal_size / 2)
+	compact_journal ();
+    }
+#else
+  paxfatal (0, _("--watch-changes is not supported on this platform"));
+#endif
+}
@@ -186,11 +186,15 @@ read_and (void (*do_something) (void))
   name_gather ();
 
   open_archive (ACCESS_READ);
+  bool indexed = seek_index_begin ();
   do
     {
       prev_status = status;
       tar_stat_destroy (&current_stat_info);
 
+      if (indexed && !seek_index_next ())
+	break;
+
       status = read_header (&current_header, &current_stat_info,
                             read_header_auto);
       switch (status)
@@ -238,7 +242,11 @@ read_and (void (*do_something) (void))
 
 	  if (transform_stat_info (current_header->header.typeflag,
 				   &current_stat_info))
-	    (*do_something) ();
+	    {
+	      stats_member (current_header->header.typeflag,
+			    current_stat_info.stat.st_size);
+	      (*do_something) ();
+	    }
 	  else
 	    skip_member ();
 	  continue;
@@ -336,6 +344,38 @@ list_archive (void)
   skip_member ();
 }
 
+/* Return the sum of the bytes of BLOCK, taken as unsigned.  If HIGH,
+   also store in *HIGH the number of those bytes that have their most
+   significant bit set.  This is done a word at a time, as it is needed
+   for every header that is read or written.  */
+
+int
+block_sum (union block const *block, int *high)
+{
+  /* Add the bytes of each word pairwise into 16-bit lanes, and count
+     their high bits in 8-bit lanes.  A block has 64 words, so neither
+     count can overflow its lane.  */
+  uint_fast64_t const lanes16 = 0x00ff00ff00ff00ff;
+  uint_fast64_t const lanes8 = 0x0101010101010101;
+  uint_fast64_t sums = 0, highs = 0;
+
+  for (int i = 0; i < sizeof *block; i += sizeof (uint64_t))
+    {
+      uint64_t w;
+      memcpy (&w, block->buffer + i, sizeof w);
+      sums += (w & lanes16) + (w >> 8 & lanes16);
+      highs += w >> 7 & lanes8;
+    }
+
+  if (high)
+    {
+      highs = (highs & lanes16) + (highs >> 8 & lanes16);
+      *high = (highs * 0x0001000100010001) >> 48 & 0xffff;
+    }
+  sums = (sums & 0x0000ffff0000ffff) + (sums >> 16 & 0x0000ffff0000ffff);
+  return (sums & 0xffffffff) + (sums >> 32 & 0xffffffff);
+}
+
 /* Check header checksum */
 
 /* 7th Edition Unix tar created the checksum by adding the bytes
@@ -345,19 +385,15 @@ list_archive (void)
    standardized on using unsigned char for checksums, old tar files
    created by pre-standard programs may have used plain char,
    which may happen to have been signed.  So tar_checksum
-   computes two checksums -- signed and unsigned.  */
+   computes two checksums -- signed and unsigned.  The signed one
+   is derived from the unsigned one, as each byte with its high bit
+   set counts 256 less when taken as signed.  */
 
 enum read_header
 tar_checksum (union block *header, bool silent)
 {
-  int unsigned_sum = 0;		/* the POSIX one :-) */
-  int signed_sum = 0;		/* the Sun one :-( */
-
-  for (int i = 0; i < sizeof *header; i++)
-    {
-      unsigned char uc = header->buffer[i]; unsigned_sum += uc;
-      signed   char sc = header->buffer[i];   signed_sum += sc;
-    }
+  int high;
+  int unsigned_sum = block_sum (header, &high);	/* the POSIX one :-) */
 
   if (unsigned_sum == 0)
     return HEADER_ZERO_BLOCK;
@@ -366,11 +402,13 @@ tar_checksum (union block *header, bool silent)
 
   for (int i = 0; i < sizeof header->header.chksum; i++)
     {
-      unsigned char uc = header->header.chksum[i]; unsigned_sum -= uc;
-      signed   char sc = header->header.chksum[i];   signed_sum -= sc;
+      unsigned char uc = header->header.chksum[i];
+      unsigned_sum -= uc;
+      high -= uc >> 7;
     }
   unsigned_sum += ' ' * sizeof header->header.chksum;
-  signed_sum   += ' ' * sizeof header->header.chksum;
+
+  int signed_sum = unsigned_sum - 256 * high;	/* the Sun one :-( */
 
   int recorded_sum = from_header (header->header.chksum,
 				  sizeof header->header.chksum, NULL,
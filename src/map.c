@@ -21,7 +21,6 @@
 #include "common.h"
 #include "wordsplit.h"
 #include <hash.h>
-#include <pwd.h>
 
 struct mapentry
 {
@@ -188,8 +187,8 @@ static Hash_table *owner_map;
 static uintmax_t
 name_to_uid (char const *name)
 {
-  struct passwd *pw = getpwnam (name);
-  return pw ? pw->pw_uid : UINTMAX_MAX;
+  uid_t uid;
+  return uname_to_uid (name, &uid) ? uid : UINTMAX_MAX;
 }
 
 void
@@ -229,8 +228,8 @@ static Hash_table *group_map;
 static uintmax_t
 name_to_gid (char const *name)
 {
-  struct group *gr = getgrnam (name);
-  return gr ? gr->gr_gid : UINTMAX_MAX;
+  gid_t gid;
+  return gname_to_gid (name, &gid) ? gid : UINTMAX_MAX;
 }
 
 void
@@ -916,6 +916,24 @@ blocking_read (int fd, void *buf, idx_t count)
   return bytes;
 }
 
+/* Tell the system that the SIZE bytes of file FD are about to be
+   read sequentially, so that it reads them ahead in larger chunks
+   while tar is busy writing the archive.  Start reading the first
+   READ_AHEAD_SIZE bytes right away.  Files that fit into a record are
+   read by a single call anyway, so do not waste system calls on
+   them.  */
+void
+read_ahead (int fd, off_t size)
+{
+#if HAVE_POSIX_FADVISE
+  if (record_size < size)
+    {
+      posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      posix_fadvise (fd, 0, min (size, READ_AHEAD_SIZE), POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
 /* Write to FD from the buffer BUF with COUNT bytes.  Do a full write.
    Wait until an output buffer is available; this matters because
    files are opened O_NONBLOCK for security reasons, and on some file
@@ -1132,12 +1150,12 @@ chdir_id (void)
 }
 
 /* Caches of recent calls to fdbase and fdbase1.  */
-static struct fdbase_cache
+struct fdbase_cache
 {
   /* Length of subdirectory name, which need not be null-terminated.
      If the length is zero, no subdir is cached here:
      SUBDIR (if nonnull) is merely a buffer available for use later,
-     and CHDIR_CURRENT and FD are irrelevant.  */
+     and CHDIR_CURRENT, FD and LAST_USE are irrelevant.  */
   idx_t subdirlen;
 
   /* Index of ancestor of this subdirectory.  */
@@ -1151,7 +1169,35 @@ static struct fdbase_cache
 
   /* FD of subdirectory.  */
   int fd;
-} fdbase_cache[2];
+
+  /* Value of fdbase_clock when this entry was last used.  */
+  uintmax_t last_use;
+};
+
+/* Number of directories cached for fdbase.  When extracting, files
+   arrive in archive order, which mostly visits sibling directories one
+   after another; keeping their ancestors open lets each directory be
+   opened with a single openat relative to its parent, instead of
+   resolving its whole name from chdir_fd.  */
+enum { FDBASE_CACHE_SIZE = 32 };
+
+/* The cache for fdbase, and the single-entry cache for fdbase1.  */
+static struct fdbase_cache fdbase_cache[FDBASE_CACHE_SIZE];
+static struct fdbase_cache fdbase1_cache;
+
+/* Incremented each time fdbase uses a cache entry.  */
+static uintmax_t fdbase_clock;
+
+static void
+fdbase_cache_clear (struct fdbase_cache *c)
+{
+  if (c->subdirlen)
+    {
+      if (0 <= c->fd)
+	close (c->fd);
+      c->subdirlen = 0;
+    }
+}
 
 /* Clear the fdbase cache.  Call this after any action that might
    invalidate the cache.  Such actions include removing or renaming
@@ -1161,16 +1207,9 @@ static struct fdbase_cache
 void
 fdbase_clear (void)
 {
-  for (int i = 0; i < 2; i++)
-    {
-      struct fdbase_cache *c = &fdbase_cache[i];
-      if (c->subdirlen)
-	{
-	  if (0 <= c->fd)
-	    close (c->fd);
-	  c->subdirlen = 0;
-	}
-    }
+  for (int i = 0; i < FDBASE_CACHE_SIZE; i++)
+    fdbase_cache_clear (&fdbase_cache[i]);
+  fdbase_cache_clear (&fdbase1_cache);
 }
 
 /* Starting from the directory FD, open a subdirectory SUBDIR for search.
@@ -1183,19 +1222,12 @@ open_subdir (int fd, char const *subdir)
   return openat2 (fd, subdir, &open_searchdir_how, sizeof open_searchdir_how);
 }
 
-/* Return an fd open to FILE_NAME's parent directory,
-   along with the base name of FILE_NAME.
-   Use the alternate cache if ALTERNATE, the main cache otherwise.
-   If FILE_NAME is relative, it is relative to chdir_fd.
-   Return AT_FDCWD if FILE_NAME is relative to the working directory.
-   Return BADFD (setting errno) on failure.  */
-static struct fdbase
-fdbase_opendir (char const *file_name, bool alternate)
+/* Skip past leading "./"s in FILE_NAME,
+   but not past the last "./" if that ends the name.  */
+static char const *
+skip_dotslashes (char const *file_name)
 {
   char const *name = file_name;
-
-  /* Skip past leading "./"s,
-     but not past the last "./" if that ends the name.  */
   idx_t dslen = dotslashlen (name);
   if (dslen)
     {
@@ -1204,30 +1236,49 @@ fdbase_opendir (char const *file_name, bool alternate)
 	for (name--; *--name != '.'; )
 	  continue;
     }
+  return name;
+}
 
-  /* For files immediately under CHDIR_FD, and for root directories,
-     just use CHDIR_FD and NAME.  */
-  char const *base = last_component (name);
-  idx_t subdirlen = base - name;
-  if (!subdirlen | !*base)
-    return (struct fdbase) { .fd = chdir_fd, .base = name };
+/* Return true if the cache entry C holds an ancestor of the directory
+   NAME, whose length is SUBDIRLEN, or NAME itself.  */
+static bool
+fdbase_cache_match (struct fdbase_cache const *c,
+		    char const *name, idx_t subdirlen)
+{
+  return (0 < c->subdirlen && c->subdirlen <= subdirlen
+	  && c->chdir_current == chdir_current
+	  && !ISSLASH (name[c->subdirlen])
+	  && memeq (c->subdir, name, c->subdirlen));
+}
 
-  struct fdbase_cache *c = &fdbase_cache[alternate];
+/* Copy the SUBDIRLEN bytes of the directory name NAME into the
+   cache entry C.  */
+static void
+fdbase_cache_set_name (struct fdbase_cache *c,
+		       char const *name, idx_t subdirlen)
+{
+  if (c->subdiralloc <= subdirlen)
+    c->subdir = xpalloc (c->subdir, &c->subdiralloc,
+			 subdirlen - c->subdiralloc + 1, -1, 1);
+  char *p = mempcpy (c->subdir, name, subdirlen);
+  *p = '\0';
+}
+
+/* Return an fd open to the directory NAME, of length SUBDIRLEN, using
+   the single-entry cache C.  BASE is the base name to be returned with
+   the fd.  */
+static struct fdbase
+fdbase_opendir1 (struct fdbase_cache *c, char const *name, idx_t subdirlen,
+		 char const *base)
+{
   int fd = c->fd;
-  bool submatch = (0 < c->subdirlen && c->subdirlen <= subdirlen
-		   && c->chdir_current == chdir_current
-		   && !ISSLASH (name[c->subdirlen])
-		   && memeq (c->subdir, name, c->subdirlen));
+  bool submatch = fdbase_cache_match (c, name, subdirlen);
 
   if (! (submatch && c->subdirlen == subdirlen))
     {
       /* Copy the new directory's name into the cache.  */
+      fdbase_cache_set_name (c, name, subdirlen);
       char *subdir = c->subdir;
-      if (c->subdiralloc <= subdirlen)
-	c->subdir = subdir = xpalloc (subdir, &c->subdiralloc,
-				      subdirlen - c->subdiralloc + 1, -1, 1);
-      char *p = mempcpy (subdir, name, subdirlen);
-      *p = '\0';
 
       if (submatch && c->subdirlen < subdirlen
 	  && !ISSLASH (subdir[c->subdirlen]))
@@ -1279,6 +1330,122 @@ fdbase_opendir (char const *file_name, bool alternate)
   return (struct fdbase) { .fd = fd, .base = base };
 }
 
+/* Return an fd open to the directory NAME, of length SUBDIRLEN, using
+   the multiple-entry cache.  BASE is the base name to be returned with
+   the fd.  */
+static struct fdbase
+fdbase_opendir_cached (char const *name, idx_t subdirlen, char const *base)
+{
+  struct fdbase_cache *ancestor = NULL;
+  struct fdbase_cache *victim = &fdbase_cache[0];
+
+  /* Look for the directory itself, or else its nearest cached ancestor,
+     and for the entry to reuse if it must be opened.  */
+  for (int i = 0; i < FDBASE_CACHE_SIZE; i++)
+    {
+      struct fdbase_cache *c = &fdbase_cache[i];
+      if (fdbase_cache_match (c, name, subdirlen))
+	{
+	  if (c->subdirlen == subdirlen)
+	    {
+	      c->last_use = ++fdbase_clock;
+	      return (struct fdbase) { .fd = c->fd, .base = base };
+	    }
+	  if (!ancestor || ancestor->subdirlen < c->subdirlen)
+	    ancestor = c;
+	}
+      if (victim->subdirlen
+	  && (!c->subdirlen || c->last_use < victim->last_use))
+	victim = c;
+    }
+
+  /* Do not evict the ancestor that the directory is opened from.  */
+  if (victim == ancestor)
+    for (int i = 0; i < FDBASE_CACHE_SIZE; i++)
+      {
+	struct fdbase_cache *c = &fdbase_cache[i];
+	if (c != ancestor && (victim == ancestor
+			      || c->last_use < victim->last_use))
+	  victim = c;
+      }
+
+  fdbase_cache_clear (victim);
+  fdbase_cache_set_name (victim, name, subdirlen);
+
+  int fd;
+  if (ancestor)
+    {
+      ancestor->last_use = ++fdbase_clock;
+      fd = open_subdir (ancestor->fd, &victim->subdir[ancestor->subdirlen]);
+      if (fd < 0 && errno != EMFILE && errno != ENFILE)
+	return (struct fdbase) { .fd = BADFD, .base = base };
+    }
+  else
+    fd = open_subdir (chdir_fd, victim->subdir);
+
+  if (fd < 0 && (errno == EMFILE || errno == ENFILE))
+    {
+      /* Give back the cached descriptors and retry from chdir_fd.  */
+      for (int i = 0; i < FDBASE_CACHE_SIZE; i++)
+	if (&fdbase_cache[i] != victim)
+	  fdbase_cache_clear (&fdbase_cache[i]);
+      fd = open_subdir (chdir_fd, victim->subdir);
+    }
+
+  if (fd < 0)
+    return (struct fdbase) { .fd = BADFD, .base = base };
+
+  victim->chdir_current = chdir_current;
+  victim->fd = fd;
+  victim->subdirlen = subdirlen;
+  victim->last_use = ++fdbase_clock;
+  return (struct fdbase) { .fd = fd, .base = base };
+}
+
+/* Return an fd open to FILE_NAME's parent directory,
+   along with the base name of FILE_NAME.
+   Use the alternate cache if ALTERNATE, the main cache otherwise.
+   If FILE_NAME is relative, it is relative to chdir_fd.
+   Return AT_FDCWD if FILE_NAME is relative to the working directory.
+   Return BADFD (setting errno) on failure.  */
+static struct fdbase
+fdbase_opendir (char const *file_name, bool alternate)
+{
+  char const *name = skip_dotslashes (file_name);
+
+  /* For files immediately under CHDIR_FD, and for root directories,
+     just use CHDIR_FD and NAME.  */
+  char const *base = last_component (name);
+  idx_t subdirlen = base - name;
+  if (!subdirlen | !*base)
+    return (struct fdbase) { .fd = chdir_fd, .base = name };
+
+  return (alternate
+	  ? fdbase_opendir1 (&fdbase1_cache, name, subdirlen, base)
+	  : fdbase_opendir_cached (name, subdirlen, base));
+}
+
+/* Return the length of the longest leading directory of FILE_NAME
+   that fdbase has found to exist, or 0 if there is none.  The length
+   includes any "./" prefix and the trailing slash.  */
+idx_t
+fdbase_known_prefix (char const *file_name)
+{
+  char const *name = skip_dotslashes (file_name);
+  idx_t namelen = strlen (name);
+  idx_t known = 0;
+
+  for (int i = 0; i < FDBASE_CACHE_SIZE; i++)
+    {
+      struct fdbase_cache const *c = &fdbase_cache[i];
+      if (known < c->subdirlen && c->subdirlen < namelen
+	  && fdbase_cache_match (c, name, namelen))
+	known = c->subdirlen;
+    }
+
+  return known ? name - file_name + known : 0;
+}
+
 struct fdbase
 fdbase (char const *name)
 {
@@ -18,6 +18,7 @@
 #include <system.h>
 
 #include <c-ctype.h>
+#include <flexmember.h>
 #include <fnmatch.h>
 #include <hash.h>
 #include <quotearg.h>
@@ -302,7 +303,7 @@ static void
 add_exclude_array (char const *const *fv, int opts)
 {
   for (int i = 0; fv[i]; i++)
-    add_exclude (excluded, fv[i], opts);
+    add_exclude_pattern (excluded, fv[i], opts);
 }
 
 static void
@@ -315,7 +316,7 @@ handle_file_selection_option (int key, const char *arg)
       break;
 
     case EXCLUDE_OPTION:
-      add_exclude (excluded, arg, exclude_options ());
+      add_exclude_pattern (excluded, arg, exclude_options ());
       break;
 
     case EXCLUDE_CACHES_OPTION:
@@ -388,7 +389,7 @@ handle_file_selection_option (int key, const char *arg)
       break;
 
     case 'X':
-      if (add_exclude_file (add_exclude, excluded, arg,
+      if (add_exclude_file (add_exclude_pattern, excluded, arg,
 			    exclude_options (), '\n')
 	  < 0)
 	paxfatal (errno, "%s", quotearg_colon (arg));
@@ -458,79 +459,152 @@ struct argp names_argp = {
    This code should also be modified for non-UNIX systems to do something
    reasonable.  */
 
-static char *cached_uname;
-static char *cached_gname;
+/* Caches of the user and group databases, as looking up an entry may
+   require a network round trip.  Each cache has two tables, mapping
+   ids to names and names to ids, with entries for ids and names that
+   do not exist as well.  */
 
-static uid_t cached_uid;	/* valid only if cached_uname is not empty */
-static gid_t cached_gid;	/* valid only if cached_gname is not empty */
+struct id_cache_entry
+{
+  uintmax_t id;			/* User or group ID */
+  bool found;			/* True if ID and NAME exist */
+  char const *name;		/* User or group name, in NAMEBUF */
+  char namebuf[FLEXIBLE_ARRAY_MEMBER];
+};
 
-/* These variables are valid only if nonempty.  */
-static char *cached_no_such_uname;
-static char *cached_no_such_gname;
+struct id_cache
+{
+  Hash_table *by_id;
+  Hash_table *by_name;
+};
 
-/* These variables are valid only if nonzero.  It's not worth optimizing
-   the case for weird systems where 0 is not a valid uid or gid.  */
-static uid_t cached_no_such_uid;
-static gid_t cached_no_such_gid;
+static struct id_cache user_cache;
+static struct id_cache group_cache;
 
-/* Given UID, find the corresponding UNAME.  */
-void
-uid_to_uname (uid_t uid, char **uname)
+/* Maximum number of entries in a table.  A table that grows larger is
+   emptied, so that tar does not hog memory when reading archives with
+   many distinct owners.  */
+enum { ID_CACHE_MAX = 1 << 16 };
+
+static size_t
+id_cache_id_hash (void const *entry, size_t n_buckets)
 {
-  struct passwd *passwd;
+  struct id_cache_entry const *p = entry;
+  return p->id % n_buckets;
+}
 
-  if (uid != 0 && uid == cached_no_such_uid)
+static bool
+id_cache_id_compare (void const *entry1, void const *entry2)
+{
+  struct id_cache_entry const *p1 = entry1;
+  struct id_cache_entry const *p2 = entry2;
+  return p1->id == p2->id;
+}
+
+static size_t
+id_cache_name_hash (void const *entry, size_t n_buckets)
+{
+  struct id_cache_entry const *p = entry;
+  return hash_string (p->name, n_buckets);
+}
+
+static bool
+id_cache_name_compare (void const *entry1, void const *entry2)
+{
+  struct id_cache_entry const *p1 = entry1;
+  struct id_cache_entry const *p2 = entry2;
+  return streq (p1->name, p2->name);
+}
+
+/* Add to *TABLE an entry for ID and NAME, telling whether they were
+   FOUND in the database, and return it.  Use HASHER and COMPARATOR
+   when creating the table.  */
+static struct id_cache_entry const *
+id_cache_add (Hash_table **table, Hash_hasher hasher,
+	      Hash_comparator comparator,
+	      uintmax_t id, char const *name, bool found)
+{
+  if (!*table)
     {
-      *uname = xstrdup ("");
-      return;
+      *table = hash_initialize (0, NULL, hasher, comparator, free);
+      if (!*table)
+	xalloc_die ();
     }
+  else if (ID_CACHE_MAX <= hash_get_n_entries (*table))
+    hash_clear (*table);
+
+  idx_t namesize = strlen (name) + 1;
+  struct id_cache_entry *ent
+    = xmalloc (FLEXNSIZEOF (struct id_cache_entry, namebuf, namesize));
+  ent->id = id;
+  ent->found = found;
+  ent->name = memcpy (ent->namebuf, name, namesize);
+  if (!hash_insert (*table, ent))
+    xalloc_die ();
+  return ent;
+}
+
+/* Return the entry for ID in the id table of CACHE, or a null
+   pointer if there is none.  */
+static struct id_cache_entry const *
+id_cache_find_id (struct id_cache const *cache, uintmax_t id)
+{
+  struct id_cache_entry key = { .id = id };
+  return cache->by_id ? hash_lookup (cache->by_id, &key) : NULL;
+}
+
+/* Record in CACHE that ID has NAME, which is empty if ID has no name.  */
+static struct id_cache_entry const *
+id_cache_add_id (struct id_cache *cache, uintmax_t id, char const *name)
+{
+  return id_cache_add (&cache->by_id, id_cache_id_hash, id_cache_id_compare,
+		       id, name, !!*name);
+}
+
+/* Return the entry for NAME in the name table of CACHE, or a null
+   pointer if there is none.  */
+static struct id_cache_entry const *
+id_cache_find_name (struct id_cache const *cache, char const *name)
+{
+  struct id_cache_entry key = { .name = name };
+  return cache->by_name ? hash_lookup (cache->by_name, &key) : NULL;
+}
+
+/* Record in CACHE that NAME has ID if FOUND, and that it does not
+   exist otherwise.  */
+static struct id_cache_entry const *
+id_cache_add_name (struct id_cache *cache, char const *name,
+		   uintmax_t id, bool found)
+{
+  return id_cache_add (&cache->by_name,
+		       id_cache_name_hash, id_cache_name_compare,
+		       id, name, found);
+}
 
-  if (!cached_uname || uid != cached_uid)
+/* Given UID, find the corresponding UNAME.  */
+void
+uid_to_uname (uid_t uid, char **uname)
+{
+  struct id_cache_entry const *ent = id_cache_find_id (&user_cache, uid);
+  if (!ent)
     {
-      passwd = getpwuid (uid);
-      if (passwd)
-	{
-	  cached_uid = uid;
-	  assign_string (&cached_uname, passwd->pw_name);
-	}
-      else
-	{
-	  cached_no_such_uid = uid;
-	  *uname = xstrdup ("");
-	  return;
-	}
+      struct passwd *passwd = getpwuid (uid);
+      ent = id_cache_add_id (&user_cache, uid, passwd ? passwd->pw_name : "");
     }
-  *uname = xstrdup (cached_uname);
+  *uname = xstrdup (ent->name);
 }
 
 /* Given GID, find the corresponding GNAME.  */
 void
 gid_to_gname (gid_t gid, char **gname)
 {
-  struct group *group;
-
-  if (gid != 0 && gid == cached_no_such_gid)
+  struct id_cache_entry const *ent = id_cache_find_id (&group_cache, gid);
+  if (!ent)
     {
-      *gname = xstrdup ("");
-      return;
+      struct group *group = getgrgid (gid);
+      ent = id_cache_add_id (&group_cache, gid, group ? group->gr_name : "");
     }
-
-  if (!cached_gname || gid != cached_gid)
-    {
-      group = getgrgid (gid);
-      if (group)
-	{
-	  cached_gid = gid;
-	  assign_string (&cached_gname, group->gr_name);
-	}
-      else
-	{
-	  cached_no_such_gid = gid;
-	  *gname = xstrdup ("");
-	  return;
-	}
-    }
-  *gname = xstrdup (cached_gname);
+  *gname = xstrdup (ent->name);
 }
 
 /* Given UNAME, set the corresponding UID and return true,
@@ -538,29 +612,16 @@ gid_to_gname (gid_t gid, char **gname)
 bool
 uname_to_uid (char const *uname, uid_t *uidp)
 {
-  struct passwd *passwd;
-
-  if (cached_no_such_uname
-      && streq (uname, cached_no_such_uname))
-    return false;
-
-  if (! (cached_uname
-	 && uname[0] == cached_uname[0]
-	 && streq (uname, cached_uname)))
+  struct id_cache_entry const *ent = id_cache_find_name (&user_cache, uname);
+  if (!ent)
     {
-      passwd = getpwnam (uname);
-      if (passwd)
-	{
-	  cached_uid = passwd->pw_uid;
-	  assign_string (&cached_uname, passwd->pw_name);
-	}
-      else
-	{
-	  assign_string (&cached_no_such_uname, uname);
-	  return false;
-	}
+      struct passwd *passwd = getpwnam (uname);
+      ent = id_cache_add_name (&user_cache, uname,
+			       passwd ? passwd->pw_uid : 0, !!passwd);
     }
-  *uidp = cached_uid;
+  if (!ent->found)
+    return false;
+  *uidp = ent->id;
   return true;
 }
 
@@ -569,29 +630,16 @@ uname_to_uid (char const *uname, uid_t *uidp)
 bool
 gname_to_gid (char const *gname, gid_t *gidp)
 {
-  struct group *group;
-
-  if (cached_no_such_gname
-      && streq (gname, cached_no_such_gname))
-    return false;
-
-  if (! (cached_gname
-	 && gname[0] == cached_gname[0]
-	 && streq (gname, cached_gname)))
+  struct id_cache_entry const *ent = id_cache_find_name (&group_cache, gname);
+  if (!ent)
     {
-      group = getgrnam (gname);
-      if (group)
-	{
-	  cached_gid = group->gr_gid;
-	  assign_string (&cached_gname, gname);
-	}
-      else
-	{
-	  assign_string (&cached_no_such_gname, gname);
-	  return false;
-	}
+      struct group *group = getgrnam (gname);
+      ent = id_cache_add_name (&group_cache, gname,
+			       group ? group->gr_gid : 0, !!group);
     }
-  *gidp = cached_gid;
+  if (!ent->found)
+    return false;
+  *gidp = ent->id;
   return true;
 }
 
@@ -1158,8 +1206,207 @@ name_is_wildcard (struct name const *name)
     fnmatch_pattern_has_wildcards (name->name, name->matching_flags);
 }
 
-/* Gather names in a list for scanning.  Could hash them later if we
-   really care.
+/* Return true if NAME matches only member names equal to it, or, when
+   recursing, lying under it.  */
+static bool
+name_literal_p (struct name const *name)
+{
+  return (!name->is_wildcard
+	  && (name->matching_flags & EXCLUDE_ANCHORED)
+	  && ! (name->matching_flags & FNM_CASEFOLD)
+	  && ! ((name->matching_flags & EXCLUDE_WILDCARDS)
+		&& strchr (name->name, '\\')));
+}
+
+/* Index of the name list, so that name_match need not try every name
+   for every archive member.  */
+
+/* An entry of the name list, and its position in it.  */
+struct indexed_name
+{
+  struct name *name;
+  idx_t ordinal;
+};
+
+/* Literal names, sorted by name and then by position.  */
+static struct indexed_name *literal_names;
+static idx_t literal_count;
+
+/* All other names, in list order.  */
+static struct indexed_name *other_names;
+static idx_t other_count;
+
+/* Map from each literal name to the first of its entries in
+   literal_names.  */
+static Hash_table *literal_table;
+
+/* True if the index describes the current name list.  */
+static bool name_index_valid;
+
+/* Names matching the member being looked up.  */
+static struct indexed_name *name_matches;
+static idx_t name_matches_alloc;
+
+static size_t
+indexed_name_hash (void const *entry, size_t n_buckets)
+{
+  struct name const *p = ((struct indexed_name const *) entry)->name;
+  size_t value = 0;
+
+  for (idx_t i = 0; i < p->length; i++)
+    value = (value * 31 + (unsigned char) p->name[i]) % n_buckets;
+  return value;
+}
+
+static bool
+indexed_name_compare (void const *entry1, void const *entry2)
+{
+  struct name const *p1 = ((struct indexed_name const *) entry1)->name;
+  struct name const *p2 = ((struct indexed_name const *) entry2)->name;
+  return p1->length == p2->length && memeq (p1->name, p2->name, p1->length);
+}
+
+static int
+compare_indexed_names (void const *a, void const *b)
+{
+  struct indexed_name const *n1 = a;
+  struct indexed_name const *n2 = b;
+  int d = strcmp (n1->name->name, n2->name->name);
+  return d ? d : (n1->ordinal > n2->ordinal) - (n1->ordinal < n2->ordinal);
+}
+
+static int
+compare_ordinals (void const *a, void const *b)
+{
+  struct indexed_name const *n1 = a;
+  struct indexed_name const *n2 = b;
+  return (n1->ordinal > n2->ordinal) - (n1->ordinal < n2->ordinal);
+}
+
+/* Forget the index, as the name list has changed.  */
+static void
+name_index_free (void)
+{
+  if (name_index_valid)
+    {
+      hash_free (literal_table);
+      literal_table = NULL;
+      free (literal_names);
+      literal_names = NULL;
+      literal_count = 0;
+      free (other_names);
+      other_names = NULL;
+      other_count = 0;
+      name_index_valid = false;
+    }
+}
+
+/* Build the index of the name list.  */
+static void
+name_index_build (void)
+{
+  idx_t literal_alloc = 0, other_alloc = 0;
+  idx_t ordinal = 0;
+
+  for (struct name *p = namelist; p; p = p->next, ordinal++)
+    if (p->name[0])
+      {
+	struct indexed_name n = { p, ordinal };
+	if (name_literal_p (p))
+	  {
+	    if (literal_count == literal_alloc)
+	      literal_names = xpalloc (literal_names, &literal_alloc, 1, -1,
+				       sizeof *literal_names);
+	    literal_names[literal_count++] = n;
+	  }
+	else
+	  {
+	    if (other_count == other_alloc)
+	      other_names = xpalloc (other_names, &other_alloc, 1, -1,
+				     sizeof *other_names);
+	    other_names[other_count++] = n;
+	  }
+      }
+
+  qsort (literal_names, literal_count, sizeof *literal_names,
+	 compare_indexed_names);
+  literal_table = hash_initialize (literal_count, NULL, indexed_name_hash,
+				   indexed_name_compare, NULL);
+  if (!literal_table)
+    xalloc_die ();
+  for (idx_t i = 0; i < literal_count; i++)
+    if (i == 0
+	|| !indexed_name_compare (&literal_names[i - 1], &literal_names[i]))
+      if (!hash_insert (literal_table, &literal_names[i]))
+	xalloc_die ();
+
+  name_index_valid = true;
+}
+
+static void
+add_name_match (struct indexed_name n, idx_t *count)
+{
+  if (*count == name_matches_alloc)
+    name_matches = xpalloc (name_matches, &name_matches_alloc, 1, -1,
+			    sizeof *name_matches);
+  name_matches[(*count)++] = n;
+}
+
+/* Store in name_matches the entries of the name list that match
+   FILE_NAME, in list order, and return their number.  Look up the
+   literal names equal to FILE_NAME or to one of its leading
+   directories in the index, and try the other names one by one.  */
+static idx_t
+namelist_matches (char const *file_name)
+{
+  idx_t count = 0;
+
+  if (same_order_option)
+    {
+      /* The name list is read one name at a time; do not index it.  */
+      for (struct name *p = namelist; p; p = p->next)
+	if (p->name[0]
+	    && exclude_fnmatch (p->name, file_name, p->matching_flags))
+	  add_name_match ((struct indexed_name) { p, count }, &count);
+      return count;
+    }
+
+  if (!name_index_valid)
+    name_index_build ();
+
+  if (literal_count)
+    {
+      idx_t len = strlen (file_name);
+      for (idx_t l = 1; l <= len; l++)
+	if (l == len || file_name[l] == '/')
+	  {
+	    struct name key = { .name = (char *) file_name, .length = l };
+	    struct indexed_name const *first
+	      = hash_lookup (literal_table,
+			     &(struct indexed_name) { .name = &key });
+	    if (first)
+	      for (struct indexed_name const *n = first;
+		   (n < literal_names + literal_count
+		    && indexed_name_compare (n, first));
+		   n++)
+		if (l == len || (n->name->matching_flags & FNM_LEADING_DIR))
+		  add_name_match (*n, &count);
+	  }
+    }
+
+  for (idx_t i = 0; i < other_count; i++)
+    {
+      struct name *p = other_names[i].name;
+      if (exclude_fnmatch (p->name, file_name, p->matching_flags))
+	add_name_match (other_names[i], &count);
+    }
+
+  if (1 < count)
+    qsort (name_matches, count, sizeof *name_matches, compare_ordinals);
+  return count;
+}
+
+/* Gather names in a list for scanning.
 
    If the names are already sorted to match the archive, we just read
    them one by one.  name_gather reads the first one, and it is called
@@ -1197,6 +1444,7 @@ name_gather (void)
 	  buffer->is_wildcard = name_is_wildcard (buffer);
 
 	  namelist = nametail = buffer;
+	  name_index_free ();
 	}
       else if (change_dir)
 	addname (NULL, change_dir, false, NULL);
@@ -1246,6 +1494,7 @@ addname (char const *string, idx_t change_dir, bool cmdline,
   else
     namelist = name;
   nametail = name;
+  name_index_free ();
   return name;
 }
 
@@ -1276,6 +1525,7 @@ add_starting_file (char const *file_name)
   name->is_wildcard = name_is_wildcard (name);
 
   starting_file_option = true;
+  name_index_free ();
 }
 
 /* Find a match for FILE_NAME in the name list.  If EXACT is true,
@@ -1314,6 +1564,8 @@ remname (struct name *name)
     p->prev = name->prev;
   else
     nametail = name->prev;
+
+  name_index_free ();
 }
 
 /* Update CURSOR to remember that it matched FILE_NAME. */
@@ -1342,10 +1594,12 @@ name_match (const char *file_name)
 	  chdir_do (cursor->change_dir);
 	  namelist = NULL;
 	  nametail = NULL;
+	  name_index_free ();
 	  return true;
 	}
 
-      cursor = namelist_match (file_name, false);
+      idx_t nmatches = namelist_matches (file_name);
+      cursor = nmatches ? name_matches[0].name : NULL;
       if (starting_file_option)
 	{
 	  /* If starting_file_option is set, the head of the list is the name
@@ -1360,23 +1614,17 @@ name_match (const char *file_name)
 	{
 	  /*
 	   * Found the first match.  It is still possible that the namelist
-	   * contains other entries that also match that filename.  Find all
-	   * such entries and update their found_count to avoid spurious
-	   * "Not found in archive" errors at the end of the run.
-	   *
-	   * FIXME: name matching logic should be rewritten to avoid O(N^2)
-	   * time complexity.
-	   *
-	   * On the first entry to the loop below, the first match itself is
-	   * updated.
+	   * contains other entries that also match that filename.  Update
+	   * the found_count of all of them to avoid spurious "Not found in
+	   * archive" errors at the end of the run.
 	   */
 	  struct name *found = NULL;
-	  while (cursor)
+	  for (idx_t i = 0; i < nmatches; i++)
 	    {
+	      cursor = name_matches[i].name;
 	      register_match (cursor, file_name);
 	      if (!found && isfound (cursor))
 		found = cursor;
-	      cursor = namelist_match_from (cursor->next, file_name, false);
 	    }
 
 	  if (!found)
@@ -1429,6 +1677,29 @@ all_names_found (struct tar_stat_info *p)
   return true;
 }
 
+/* Return true if every name in the namelist matches only member names
+   equal to it, or, when recursing, lying under it.  If so and FUN is
+   not null, call FUN for each of these names.  */
+bool
+name_list_literal (void (*fun) (struct name const *))
+{
+  struct name const *cursor;
+
+  if (!namelist || !namelist->name[0]
+      || same_order_option || starting_file_option)
+    return false;
+
+  for (cursor = namelist; cursor; cursor = cursor->next)
+    if (cursor->name[0] && !name_literal_p (cursor))
+      return false;
+
+  if (fun)
+    for (cursor = namelist; cursor; cursor = cursor->next)
+      if (cursor->name[0])
+	fun (cursor);
+  return true;
+}
+
 static bool
 regex_usage_warning (const char *name)
 {
@@ -1772,8 +2043,11 @@ collect_and_sort_names (void)
 	}
 
       read_directory_file ();
+      change_journal_read ();
     }
 
+  bool scan_workers_started = incremental_option && start_scan_workers ();
+
   num_names = 0;
   for (name = namelist; name; name = name->next, num_names++)
     {
@@ -1826,7 +2100,11 @@ collect_and_sort_names (void)
       tar_stat_destroy (&st);
     }
 
+  if (scan_workers_started)
+    stop_scan_workers ();
+
   namelist = merge_sort (namelist, num_names, compare_names);
+  name_index_free ();
 
   num_names = 0;
   nametab = hash_initialize (0, NULL, name_hash, name_compare, NULL);
@@ -1871,6 +2149,7 @@ collect_and_sort_names (void)
   hash_free (nametab);
 
   namelist = merge_sort (namelist, num_names, compare_names_found);
+  name_index_free ();
 
   if (listed_incremental_option)
     {
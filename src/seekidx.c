@@ -0,0 +1,421 @@
+/* Index files for seeking in archives.
+
+   Copyright 2026 Free Software Foundation, Inc.
+
+   This file is part of GNU tar.
+
+   GNU tar is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU tar is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <system.h>
+#include <quotearg.h>
+#include "common.h"
+
+/* An index file starts with the line
+
+     GNU tar-VERSION-index-FORMAT
+
+   which is followed by records made of null-terminated fields.  The
+   first field of each record is a single letter giving its type:
+
+     F OFFSET BLOCK  A compression frame starts at byte OFFSET of the
+		     archive file.  It decompresses into the blocks
+		     starting at block number BLOCK.
+     M BLOCK NAME    Member NAME starts at block number BLOCK, counting
+		     any long name or extended headers that precede its
+		     header.
+     E SIZE          End of index.  SIZE is the size of the archive file.
+
+   Records appear in archive order.  An uncompressed archive consists
+   of a single frame at offset 0: its members are reached by seeking
+   directly to their headers.  */
+
+enum { SEEK_INDEX_VERSION = 1 };
+
+/* Stream the index is being written to.  */
+static FILE *index_stream;
+
+/* A compression frame.  */
+struct index_frame
+{
+  off_t offset;			/* Offset in the archive file */
+  off_t block;			/* Number of its first block */
+};
+
+/* An archive member.  */
+struct index_member
+{
+  char const *name;		/* Member name */
+  off_t block;			/* Number of its first block */
+};
+
+/* Frames, sorted by block number.  */
+static struct index_frame *frames;
+static idx_t frame_count;
+
+/* Members, sorted by name, and then by block number.  */
+static struct index_member *members;
+static idx_t member_count;
+
+/* Storage for member names.  */
+static struct obstack name_stk;
+
+/* Block numbers of the members to be read, and the next one of them.  */
+static off_t *targets;
+static idx_t target_count;
+static idx_t target_alloc;
+static idx_t next_target;
+
+static off_t
+archive_file_size (void)
+{
+  struct stat st;
+  if (stat (archive_name_array[0], &st) < 0)
+    stat_fatal (archive_name_array[0]);
+  return st.st_size;
+}
+
+/* Write a record of type TYPE, consisting of the N numbers in VAL, to
+   the index.  */
+static void
+write_numeric_record (char type, int n, intmax_t const *val)
+{
+  fprintf (index_stream, "%c%c", type, 0);
+  for (int i = 0; i < n; i++)
+    fprintf (index_stream, "%jd%c", val[i], 0);
+}
+
+/* Start writing the index for the archive being created.  */
+void
+seek_index_create (void)
+{
+  if (!seek_index_option)
+    return;
+  if (!archive_is_local_file ())
+    {
+      paxwarn (0, _("Cannot index an archive that is not a regular file"));
+      return;
+    }
+
+  index_stream = fopen (seek_index_option, "w");
+  if (!index_stream)
+    open_fatal (seek_index_option);
+  fprintf (index_stream, "%s-%s-index-%d\n",
+	   PACKAGE_NAME, PACKAGE_VERSION, SEEK_INDEX_VERSION);
+  write_numeric_record ('F', 2, (intmax_t []) { 0, 0 });
+}
+
+/* Record that a new compression frame starts at block BLOCK.  This
+   must be called after the previous frame has been fully written to
+   the archive file.  */
+void
+seek_index_add_frame (off_t block)
+{
+  if (index_stream)
+    write_numeric_record ('F', 2,
+			  (intmax_t []) { archive_file_size (), block });
+}
+
+/* Record that the member described by ST starts at block BLOCK.  */
+void
+seek_index_add_member (struct tar_stat_info const *st, off_t block)
+{
+  if (index_stream)
+    {
+      /* Store the name the way read_header returns it, i.e. without
+	 trailing slashes.  */
+      char const *name = st->file_name;
+      idx_t len = strlen (name);
+      while (1 < len && ISSLASH (name[len - 1]))
+	len--;
+
+      write_numeric_record ('M', 1, (intmax_t []) { block });
+      fwrite (name, 1, len, index_stream);
+      fputc (0, index_stream);
+    }
+}
+
+/* Finish writing the index.  This must be called after the archive
+   has been closed.  */
+void
+seek_index_finish (void)
+{
+  if (index_stream)
+    {
+      write_numeric_record ('E', 1, (intmax_t []) { archive_file_size () });
+      if (ferror (index_stream))
+	write_error (seek_index_option);
+      if (fclose (index_stream) < 0)
+	close_error (seek_index_option);
+      index_stream = NULL;
+    }
+}
+
+/* Read a null-terminated field from FP into *PBUF, which has size
+   *PSIZE.  Return false on end of file or error.  */
+static bool
+read_field (FILE *fp, char **pbuf, size_t *psize)
+{
+  return 0 < getdelim (pbuf, psize, 0, fp);
+}
+
+/* Read from FP a null-terminated field holding a nonnegative number,
+   using the buffer *PBUF of size *PSIZE.  Store it in *PVAL and return
+   true if successful.  */
+static bool
+read_offset (FILE *fp, char **pbuf, size_t *psize, off_t *pval)
+{
+  char *end;
+  bool overflow;
+
+  if (!read_field (fp, pbuf, psize))
+    return false;
+  *pval = stoint (*pbuf, &end, &overflow, 0, TYPE_MAXIMUM (off_t));
+  return end != *pbuf && !*end && !overflow;
+}
+
+static int
+compare_members (void const *a, void const *b)
+{
+  struct index_member const *m1 = a;
+  struct index_member const *m2 = b;
+  int d = strcmp (m1->name, m2->name);
+  return d ? d : (m1->block > m2->block) - (m1->block < m2->block);
+}
+
+/* Read the index file.  Return true if it is valid and describes the
+   archive being read.  */
+static bool
+seek_index_read (void)
+{
+  FILE *fp = fopen (seek_index_option, "r");
+  if (!fp)
+    {
+      open_error (seek_index_option);
+      return false;
+    }
+
+  char *buf = NULL;
+  size_t bufsize = 0;
+  idx_t frame_alloc = 0;
+  idx_t member_alloc = 0;
+  off_t block = 0;
+  bool valid = false;
+  static char const magic[] = PACKAGE_NAME "-";
+
+  obstack_init (&name_stk);
+
+  /* Check the first line.  Any version of tar may have written it.  */
+  char *p;
+  if (getline (&buf, &bufsize, fp) <= 0
+      || strncmp (buf, magic, sizeof magic - 1) != 0
+      || ! (p = strstr (buf, "-index-"))
+      || stoint (p + sizeof "-index-" - 1, &p, NULL, 0, INT_MAX)
+	 != SEEK_INDEX_VERSION
+      || !streq (p, "\n"))
+    goto done;
+
+  while (read_field (fp, &buf, &bufsize))
+    {
+      if (streq (buf, "F"))
+	{
+	  struct index_frame f;
+	  if (! (read_offset (fp, &buf, &bufsize, &f.offset)
+		 && read_offset (fp, &buf, &bufsize, &f.block)
+		 && block <= f.block))
+	    break;
+	  if (frame_count == frame_alloc)
+	    frames = xpalloc (frames, &frame_alloc, 1, -1, sizeof *frames);
+	  frames[frame_count++] = f;
+	  block = f.block;
+	}
+      else if (streq (buf, "M"))
+	{
+	  struct index_member m;
+	  if (! (read_offset (fp, &buf, &bufsize, &m.block)
+		 && block <= m.block
+		 && read_field (fp, &buf, &bufsize)))
+	    break;
+	  m.name = obstack_copy0 (&name_stk, buf, strlen (buf));
+	  if (member_count == member_alloc)
+	    members = xpalloc (members, &member_alloc, 1, -1, sizeof *members);
+	  members[member_count++] = m;
+	  block = m.block;
+	}
+      else if (streq (buf, "E"))
+	{
+	  off_t size;
+	  valid = (read_offset (fp, &buf, &bufsize, &size)
+		   && frame_count && frames[0].block == 0
+		   && size == archive_file_size ());
+	  break;
+	}
+      else
+	break;
+    }
+
+ done:
+  if (ferror (fp))
+    read_error (seek_index_option);
+  fclose (fp);
+  free (buf);
+
+  if (!valid)
+    {
+      paxwarn (0, _("%s: Index does not describe the archive; ignoring it"),
+	       quotearg_colon (seek_index_option));
+      free (frames);
+      frames = NULL;
+      frame_count = 0;
+      free (members);
+      members = NULL;
+      member_count = 0;
+      obstack_free (&name_stk, NULL);
+      return false;
+    }
+
+  qsort (members, member_count, sizeof *members, compare_members);
+  return true;
+}
+
+/* Return the index of the first member whose name is not less than
+   the first LEN bytes of NAME.  */
+static idx_t
+member_lower_bound (char const *name, idx_t len)
+{
+  idx_t lo = 0, hi = member_count;
+  while (lo < hi)
+    {
+      idx_t mid = lo + (hi - lo) / 2;
+      if (strncmp (members[mid].name, name, len) < 0)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+static void
+add_target (off_t block)
+{
+  if (target_count == target_alloc)
+    targets = xpalloc (targets, &target_alloc, 1, -1, sizeof *targets);
+  targets[target_count++] = block;
+}
+
+/* Add the members matching the name list entry P to the targets.  This
+   mirrors exclude_fnmatch for literal, anchored names.  */
+static void
+add_name_targets (struct name const *p)
+{
+  idx_t i;
+
+  for (i = member_lower_bound (p->name, p->length + 1);
+       i < member_count && streq (members[i].name, p->name); i++)
+    add_target (members[i].block);
+
+  if (p->matching_flags & FNM_LEADING_DIR)
+    {
+      /* Members below the directory P->name.  */
+      for (i = member_lower_bound (p->name, p->length);
+	   (i < member_count
+	    && strncmp (members[i].name, p->name, p->length) == 0);
+	   i++)
+	if (ISSLASH (members[i].name[p->length]))
+	  add_target (members[i].block);
+    }
+}
+
+static int
+compare_offsets (void const *a, void const *b)
+{
+  off_t const *o1 = a;
+  off_t const *o2 = b;
+  return (*o1 > *o2) - (*o1 < *o2);
+}
+
+/* Prepare for reading the archive through the index, if one was
+   given and the archive and the name list permit that.  Return true
+   if the index will be used.  */
+bool
+seek_index_begin (void)
+{
+  if (! (seek_index_option && frame_seekable_archive ()
+	 && name_list_literal (NULL)
+	 && seek_index_read ()))
+    return false;
+
+  name_list_literal (add_name_targets);
+  qsort (targets, target_count, sizeof *targets, compare_offsets);
+
+  /* Remove duplicates.  */
+  idx_t n = 0;
+  for (idx_t i = 0; i < target_count; i++)
+    if (n == 0 || targets[n - 1] != targets[i])
+      targets[n++] = targets[i];
+  target_count = n;
+  next_target = 0;
+
+  /* Decode the global header, if the archive starts with one.  It
+     would be skipped otherwise.  */
+  union block *header = find_next_block ();
+  if (header && header->header.typeflag == XGLTYPE)
+    {
+      struct tar_stat_info st;
+      tar_stat_init (&st);
+      read_header (&header, &st, read_header_x_global);
+      tar_stat_destroy (&st);
+    }
+
+  return true;
+}
+
+/* Return the last frame starting at or before block BLOCK.  */
+static struct index_frame const *
+find_frame (off_t block)
+{
+  idx_t lo = 0, hi = frame_count;
+  while (hi - lo > 1)
+    {
+      idx_t mid = lo + (hi - lo) / 2;
+      if (frames[mid].block <= block)
+	lo = mid;
+      else
+	hi = mid;
+    }
+  return &frames[lo];
+}
+
+/* Position the archive at the next member to be read.  Return false
+   if there are no more such members.  */
+bool
+seek_index_next (void)
+{
+  if (next_target == target_count)
+    return false;
+
+  off_t block = targets[next_target++];
+  off_t current = current_block_ordinal ();
+  struct index_frame const *f = find_frame (block);
+
+  /* Decompress the frame from its beginning, unless the member is
+     ahead of us within the same frame.  */
+  if (! (f->block <= current && current <= block))
+    {
+      seek_archive_frame (f->offset, f->block);
+      current = f->block;
+    }
+  if (current < block)
+    skim_file ((block - current) * BLOCKSIZE, false);
+  return true;
+}
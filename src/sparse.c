@@ -53,6 +53,8 @@ struct tar_sparse_file
 				       Otherwise unused */
   off_t dumped_size;                /* Number of bytes actually written
 				       to the archive */
+  off_t old_size;                   /* Size of fd before extraction, if
+				       seekable */
   struct tar_stat_info *stat_info;  /* Information about the file */
   struct tar_sparse_optab const *optab; /* Operation table */
   void *closure;                    /* Any additional data optab calls might
@@ -187,10 +189,10 @@ lseek_or_error (struct tar_sparse_file *file, off_t offset)
 static bool
 zero_block_p (char const *buffer, idx_t size)
 {
-  for (; size; size--)
-    if (*buffer++)
-      return false;
-  return true;
+  /* The buffer is all zeros if its first byte is zero and each byte
+     equals the next one.  Checking the latter with memcmp is much
+     faster than a byte loop.  */
+  return size == 0 || (!*buffer && memcmp (buffer, buffer + 1, size - 1) == 0);
 }
 
 static void
@@ -205,55 +207,78 @@ sparse_add_map (struct tar_stat_info *st, struct sp_array const *sp)
   st->sparse_map_avail = avail + 1;
 }
 
-/* Scan the sparse file byte-by-byte and create its map. */
+/* Size of the windows in which sparse_scan_file_raw reads the file.  */
+enum { SPARSE_SCAN_WINDOW = 256 * BLOCKSIZE };
+
+/* Scan the sparse file block-by-block and create its map.  The file is
+   read in large windows, and a window that is entirely zero is skipped
+   at once.  */
 static bool
 sparse_scan_file_raw (struct tar_sparse_file *file)
 {
   struct tar_stat_info *st = file->stat_info;
   int fd = file->fd;
-  char buffer[BLOCKSIZE];
+  char *window = xmalloc (SPARSE_SCAN_WINDOW);
   off_t offset = 0;
   struct sp_array sp = {0, 0};
+  bool ok = false;
 
   st->archive_file_size = 0;
 
   if (!tar_sparse_scan (file, scan_begin, NULL))
-    return false;
+    goto done;
 
   while (true)
     {
-      idx_t count = blocking_read (fd, buffer, sizeof buffer);
-      if (count < sizeof buffer)
+      idx_t count = blocking_read (fd, window, SPARSE_SCAN_WINDOW);
+      if (count < SPARSE_SCAN_WINDOW)
 	{
 	  if (errno)
-	    read_diag_details (st->orig_file_name, offset, sizeof buffer);
+	    read_diag_details (st->orig_file_name, offset,
+			       SPARSE_SCAN_WINDOW);
 	  if (count == 0)
 	    break;
 	}
 
-      /* Analyze the block.  */
-      if (zero_block_p (buffer, count))
-        {
-          if (sp.numbytes)
-            {
-              sparse_add_map (st, &sp);
-              sp.numbytes = 0;
-              if (!tar_sparse_scan (file, scan_block, NULL))
-                return false;
-            }
-        }
+      /* A window of zeros ends the current data segment, if any, and
+	 its blocks need not be looked at one by one.  */
+      if (!file->optab->scan_block && zero_block_p (window, count))
+	{
+	  if (sp.numbytes)
+	    {
+	      sparse_add_map (st, &sp);
+	      sp.numbytes = 0;
+	    }
+	}
       else
-        {
-          if (sp.numbytes == 0)
-            sp.offset = offset;
-          sp.numbytes += count;
-          st->archive_file_size += count;
-          if (!tar_sparse_scan (file, scan_block, buffer))
-            return false;
-        }
+	/* Analyze each block.  */
+	for (idx_t i = 0; i < count; i += BLOCKSIZE)
+	  {
+	    char *buffer = window + i;
+	    idx_t bufsize = min (count - i, BLOCKSIZE);
+	    if (zero_block_p (buffer, bufsize))
+	      {
+		if (sp.numbytes)
+		  {
+		    sparse_add_map (st, &sp);
+		    sp.numbytes = 0;
+		    if (!tar_sparse_scan (file, scan_block, NULL))
+		      goto done;
+		  }
+	      }
+	    else
+	      {
+		if (sp.numbytes == 0)
+		  sp.offset = offset + i;
+		sp.numbytes += bufsize;
+		st->archive_file_size += bufsize;
+		if (!tar_sparse_scan (file, scan_block, buffer))
+		  goto done;
+	      }
+	  }
 
       offset += count;
-      if (count < sizeof buffer)
+      if (count < SPARSE_SCAN_WINDOW)
 	break;
     }
 
@@ -263,7 +288,11 @@ sparse_scan_file_raw (struct tar_sparse_file *file)
     sp.offset = offset;
 
   sparse_add_map (st, &sp);
-  return tar_sparse_scan (file, scan_end, NULL);
+  ok = tar_sparse_scan (file, scan_end, NULL);
+
+ done:
+  free (window);
+  return ok;
 }
 
 static bool
@@ -456,15 +485,78 @@ sparse_dump_region (struct tar_sparse_file *file, idx_t i)
   return true;
 }
 
+/* Make the bytes of FILE from BEG to END read as zeros.  Only the part
+   that overlaps the data FILE had before extraction needs this, e.g.
+   when extracting to standard output that is an existing file or a
+   device.  Punch a hole there if possible, so that the file stays
+   sparse, and write zeros otherwise.  */
+static bool
+sparse_clear_hole (struct tar_sparse_file *file, off_t beg, off_t end)
+{
+  static char const zero_buf[BLOCKSIZE];
+
+  end = min (end, file->old_size);
+  if (end <= beg)
+    return true;
+
+#if HAVE_FALLOCATE && defined FALLOC_FL_PUNCH_HOLE
+  if (fallocate (file->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+		 beg, end - beg)
+      == 0)
+    return true;
+#endif
+
+  if (!lseek_or_error (file, beg))
+    return false;
+  while (beg < end)
+    {
+      idx_t size = min (BLOCKSIZE, end - beg);
+      idx_t count = blocking_write (file->fd, zero_buf, size);
+      if (count != size)
+	{
+	  write_error_details (file->stat_info->orig_file_name, count, size);
+	  return false;
+	}
+      beg += count;
+    }
+  return true;
+}
+
+/* Allocate the SIZE bytes at OFFSET of FILE that are about to be
+   written, so that the file system can lay them out at once.  This
+   is only a hint.  */
+static void
+sparse_preallocate (MAYBE_UNUSED struct tar_sparse_file *file,
+		    MAYBE_UNUSED off_t offset, MAYBE_UNUSED off_t size)
+{
+#if HAVE_FALLOCATE && defined FALLOC_FL_KEEP_SIZE
+  static bool unsupported;
+
+  if (file->seekable && !unsupported
+      && fallocate (file->fd, FALLOC_FL_KEEP_SIZE, offset, size) < 0
+      && (errno == EOPNOTSUPP || errno == ENOSYS))
+    unsupported = true;
+#endif
+}
+
 static bool
 sparse_extract_region (struct tar_sparse_file *file, idx_t i)
 {
+  struct sp_array const *map = file->stat_info->sparse_map;
   off_t write_size;
 
-  if (!lseek_or_error (file, file->stat_info->sparse_map[i].offset))
+  /* Clear the hole before the region.  */
+  if (file->seekable
+      && !sparse_clear_hole (file,
+			     i ? map[i - 1].offset + map[i - 1].numbytes : 0,
+			     map[i].offset))
+    return false;
+
+  if (!lseek_or_error (file, map[i].offset))
     return false;
 
-  write_size = file->stat_info->sparse_map[i].numbytes;
+  write_size = map[i].numbytes;
+  sparse_preallocate (file, map[i].offset, write_size);
 
   if (write_size == 0)
     {
@@ -569,7 +661,8 @@ sparse_extract_file (int fd, struct tar_stat_info *st, off_t *size)
 
   file.stat_info = st;
   file.fd = fd;
-  file.seekable = lseek (fd, 0, SEEK_SET) == 0;
+  file.old_size = lseek (fd, 0, SEEK_END);
+  file.seekable = 0 <= file.old_size && lseek (fd, 0, SEEK_SET) == 0;
   file.offset = 0;
 
   rc = tar_sparse_decode_header (&file);
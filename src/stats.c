@@ -0,0 +1,249 @@
+/* Performance statistics.
+
+   Copyright 2026 Free Software Foundation, Inc.
+
+   This file is part of GNU tar.
+
+   GNU tar is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   GNU tar is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <system.h>
+#include <sys/resource.h>
+#include "common.h"
+
+/* These statistics are gathered only with --stats-format=json.
+
+   The time of each phase excludes that of the phases entered from it,
+   so that the times of all phases add up to the elapsed time.  For
+   example, the time spent writing the archive while building a header
+   counts as archive_write, not as header.  */
+
+static char const *const phase_names[] =
+{
+  [STATS_OTHER] = "other",
+  [STATS_DIRECTORY_SCAN] = "directory_scan",
+  [STATS_STAT] = "stat",
+  [STATS_FILE_READ] = "file_read",
+  [STATS_HEADER] = "header",
+  [STATS_ARCHIVE_READ] = "archive_read",
+  [STATS_ARCHIVE_WRITE] = "archive_write",
+  [STATS_FILE_WRITE] = "file_write",
+  [STATS_SET_STAT] = "set_stat"
+};
+
+/* Time spent in each phase, in nanoseconds, and number of times it
+   was entered.  */
+static intmax_t phase_ns[STATS_PHASES];
+static intmax_t phase_calls[STATS_PHASES];
+
+static enum stats_phase current_phase;
+
+/* When the current phase was last entered or resumed.  */
+static struct timespec phase_start;
+
+enum member_kind
+  {
+    MEMBER_REGULAR,
+    MEMBER_DIRECTORY,
+    MEMBER_SYMLINK,
+    MEMBER_HARDLINK,
+    MEMBER_SPECIAL,
+    MEMBER_OTHER,
+    MEMBER_KINDS
+  };
+
+static char const *const member_kind_names[] =
+{
+  [MEMBER_REGULAR] = "regular",
+  [MEMBER_DIRECTORY] = "directory",
+  [MEMBER_SYMLINK] = "symlink",
+  [MEMBER_HARDLINK] = "hardlink",
+  [MEMBER_SPECIAL] = "special",
+  [MEMBER_OTHER] = "other"
+};
+
+static intmax_t member_count[MEMBER_KINDS];
+static intmax_t member_bytes[MEMBER_KINDS];
+
+/* Number of regular members whose data was transferred at a rate of
+   at least 2**I and less than 2**(I + 1) bytes per second.  */
+static intmax_t rate_histogram[64];
+
+static bool
+stats_enabled (void)
+{
+  return stats_format_option == STATS_FORMAT_JSON;
+}
+
+static intmax_t
+elapsed_ns (struct timespec start, struct timespec end)
+{
+  return ((intmax_t) (end.tv_sec - start.tv_sec) * BILLION
+	  + end.tv_nsec - start.tv_nsec);
+}
+
+/* Add the time since PHASE_START to the current phase.  */
+static void
+account_phase (void)
+{
+  struct timespec now = current_timespec ();
+  if (phase_start.tv_sec | phase_start.tv_nsec)
+    phase_ns[current_phase] += elapsed_ns (phase_start, now);
+  else
+    phase_ns[current_phase] += elapsed_ns (start_time, now);
+  phase_start = now;
+}
+
+/* Enter PHASE.  Return the phase to pass to stats_leave.  */
+enum stats_phase
+stats_enter (enum stats_phase phase)
+{
+  enum stats_phase prev = current_phase;
+  if (stats_enabled ())
+    {
+      account_phase ();
+      current_phase = phase;
+      phase_calls[phase]++;
+    }
+  return prev;
+}
+
+/* Leave the current phase, returning to PREV.  */
+void
+stats_leave (enum stats_phase prev)
+{
+  if (stats_enabled ())
+    {
+      account_phase ();
+      current_phase = prev;
+    }
+}
+
+/* Like fstatat, but account the time spent to the stat phase.  */
+int
+stats_fstatat (int fd, char const *name, struct stat *st, int flags)
+{
+  enum stats_phase phase = stats_enter (STATS_STAT);
+  int r = fstatat (fd, name, st, flags);
+  int e = errno;
+  stats_leave (phase);
+  errno = e;
+  return r;
+}
+
+/* Count a member of type TYPEFLAG.  If it is a regular file, SIZE is
+   the size of its contents.  */
+void
+stats_member (char typeflag, off_t size)
+{
+  if (!stats_enabled ())
+    return;
+
+  enum member_kind kind;
+  switch (typeflag)
+    {
+    case REGTYPE: case AREGTYPE: case CONTTYPE: case GNUTYPE_SPARSE:
+      kind = MEMBER_REGULAR;
+      break;
+
+    case DIRTYPE: case GNUTYPE_DUMPDIR:
+      kind = MEMBER_DIRECTORY;
+      break;
+
+    case SYMTYPE:
+      kind = MEMBER_SYMLINK;
+      break;
+
+    case LNKTYPE:
+      kind = MEMBER_HARDLINK;
+      break;
+
+    case CHRTYPE: case BLKTYPE: case FIFOTYPE:
+      kind = MEMBER_SPECIAL;
+      break;
+
+    default:
+      kind = MEMBER_OTHER;
+      break;
+    }
+  member_count[kind]++;
+  if (kind == MEMBER_REGULAR)
+    member_bytes[kind] += size;
+}
+
+/* Return the time at which the transfer of the data of a member starts.  */
+struct timespec
+stats_data_begin (void)
+{
+  return stats_enabled () ? current_timespec () : (struct timespec) {0};
+}
+
+/* Note that SIZE bytes of member data, whose transfer started at
+   START, have been transferred.  */
+void
+stats_data_end (struct timespec start, off_t size)
+{
+  if (!stats_enabled () || size == 0)
+    return;
+
+  intmax_t ns = elapsed_ns (start, current_timespec ());
+  double rate = 1e9 * size / (ns ? ns : 1);
+  int i = 0;
+  while (i < 63 && 2.0 * (1ull << i) <= rate)
+    i++;
+  rate_histogram[i]++;
+}
+
+static intmax_t
+timeval_ns (struct timeval tv)
+{
+  return (intmax_t) tv.tv_sec * BILLION + tv.tv_usec * 1000;
+}
+
+/* Output the statistics to FP, as members of a JSON object.  */
+void
+format_stats_json (FILE *fp)
+{
+  if (stats_enabled ())
+    account_phase ();
+
+  fprintf (fp, "\"elapsed_ns\":%jd,\"phases\":{",
+	   elapsed_ns (start_time, current_timespec ()));
+  for (int i = 0; i < STATS_PHASES; i++)
+    fprintf (fp, "%s\"%s\":{\"ns\":%jd,\"calls\":%jd}", i ? "," : "",
+	     phase_names[i], phase_ns[i], phase_calls[i]);
+
+  struct rusage self, children;
+  if (getrusage (RUSAGE_SELF, &self) == 0
+      && getrusage (RUSAGE_CHILDREN, &children) == 0)
+    fprintf (fp, ("},\"cpu\":{\"user_ns\":%jd,\"system_ns\":%jd,"
+		  "\"children_user_ns\":%jd,\"children_system_ns\":%jd"),
+	     timeval_ns (self.ru_utime), timeval_ns (self.ru_stime),
+	     timeval_ns (children.ru_utime), timeval_ns (children.ru_stime));
+
+  fprintf (fp, "},\"members\":{");
+  for (int i = 0; i < MEMBER_KINDS; i++)
+    fprintf (fp, "%s\"%s\":{\"count\":%jd,\"bytes\":%jd}", i ? "," : "",
+	     member_kind_names[i], member_count[i], member_bytes[i]);
+
+  fprintf (fp, "},\"rate_histogram\":{");
+  bool first = true;
+  for (int i = 0; i < 64; i++)
+    if (rate_histogram[i])
+      {
+	fprintf (fp, "%s\"%ju\":%jd", first ? "" : ",",
+		 (uintmax_t) 1 << i, rate_histogram[i]);
+	first = false;
+      }
+  fprintf (fp, "}");
+}
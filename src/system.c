@@ -140,19 +140,30 @@ sys_write_archive_buffer (void)
 }
 
 /* Set ARCHIVE for writing, then compressing an archive.  */
-void
-sys_child_open_for_compress (void)
+pid_t
+sys_child_open_for_compress (bool append)
 {
   paxfatal (0, _("Cannot use compressed or remote archives"));
 }
 
 /* Set ARCHIVE for uncompressing, then reading an archive.  */
-void
-sys_child_open_for_uncompress (void)
+pid_t
+sys_child_open_for_uncompress (off_t offset)
 {
   paxfatal (0, _("Cannot use compressed or remote archives"));
 }
 
+void
+sys_drop_child (pid_t child_pid)
+{
+}
+
+pid_t
+sys_child_open_for_io (enum access_mode wanted_access, idx_t size)
+{
+  paxfatal (0, _("Cannot use a separate process for archive I/O"));
+}
+
 bool
 sys_exec_setmtime_script (const char *script_name,
 			  int dirfd,
@@ -235,6 +246,23 @@ sys_wait_for_child (pid_t child_pid, bool eof)
     }
 }
 
+/* Terminate the compression program CHILD_PID, which is no longer
+   needed, and reap it.  Its exit status is of no interest.  */
+void
+sys_drop_child (pid_t child_pid)
+{
+  if (child_pid)
+    {
+      kill (child_pid, SIGTERM);
+      while (waitpid (child_pid, NULL, 0) < 0)
+	if (errno != EINTR)
+	  {
+	    waitpid_error (use_compress_program_option);
+	    break;
+	  }
+    }
+}
+
 void
 sys_spawn_shell (void)
 {
@@ -296,7 +324,10 @@ is_regular_file (const char *name)
 idx_t
 sys_write_archive_buffer (void)
 {
-  return rmtwrite (archive, charptr (record_start), record_size);
+  enum stats_phase phase = stats_enter (STATS_ARCHIVE_WRITE);
+  idx_t written = rmtwrite (archive, charptr (record_start), record_size);
+  stats_leave (phase);
+  return written;
 }
 
 /* Read and write file descriptors from a pipe(pipefd) call.  */
@@ -350,9 +381,116 @@ wait_for_grandchild (pid_t pid)
   exit (exit_code);
 }
 
-/* Set ARCHIVE for writing, then compressing an archive.  */
+/* Run the compression program, reading the archive from stdin.
+   If --compress-threads is in effect, try its multi-threaded
+   counterpart first.  */
+static _Noreturn void
+run_compress_program (void)
+{
+  char *prog = parallel_compress_program (use_compress_program_option, false);
+
+  if (prog)
+    {
+      struct wordsplit ws;
+      ws.ws_env = (const char **) environ;
+      if (wordsplit (prog, &ws,
+		     (WRDSF_DEFFLAGS | WRDSF_ENV) & ~WRDSF_NOVAR) != WRDSE_OK)
+	paxfatal (0, _("cannot split string '%s': %s"),
+		  prog, wordsplit_strerror (&ws));
+      execvp (ws.ws_wordv[0], ws.ws_wordv);
+      warnopt (WARN_COMPRESS_PROGRAM, errno, _("cannot run %s"), prog);
+      warnopt (WARN_COMPRESS_PROGRAM, 0, _("trying %s"),
+	       use_compress_program_option);
+    }
+  xexec (use_compress_program_option);
+}
+
+/* Read records from stdin, which is the pipe from PEER, and write
+   them to the archive, padding the last one to the full record
+   size.  */
+static void
+copy_to_archive (char const *peer)
+{
+  while (1)
+    {
+      ptrdiff_t status = 0;
+      char *cursor;
+      idx_t length;
+
+      /* Assemble a record.  */
+
+      for (length = 0, cursor = charptr (record_start);
+	   length < record_size;
+	   length += status, cursor += status)
+	{
+	  idx_t size = record_size - length;
+
+	  status = safe_read (STDIN_FILENO, cursor, size);
+	  if (status < 0)
+	    read_fatal (peer);
+	  if (status == 0)
+	    break;
+	}
+
+      /* Copy the record.  */
+
+      if (status == 0)
+	{
+	  /* We hit the end of the file.  Write last record at
+	     full length, as the only role of the grandchild is
+	     doing proper reblocking.  */
+
+	  if (length > 0)
+	    {
+	      memset (charptr (record_start) + length, 0, record_size - length);
+	      status = sys_write_archive_buffer ();
+	      if (status != record_size)
+		archive_write_error (status);
+	    }
+
+	  /* There is nothing else to read, break out.  */
+	  break;
+	}
+
+      status = sys_write_archive_buffer ();
+      if (status != record_size)
+	archive_write_error (status);
+    }
+}
+
+/* Read the archive and write it to stdout, which is the pipe to
+   PEER.  */
+static void
+copy_from_archive (char const *peer)
+{
+  while (true)
+    {
+      clear_read_error_count ();
+
+      ptrdiff_t n;
+      while ((n = rmtread (archive, charptr (record_start), record_size)) < 0)
+	archive_read_error ();
+      if (n == 0)
+	break;
+
+      char *cursor = charptr (record_start);
+      do
+	{
+	  idx_t count = min (n, BLOCKSIZE);
+	  if (full_write (STDOUT_FILENO, cursor, count) != count)
+	    write_error (peer);
+	  cursor += count;
+	  n -= count;
+	}
+      while (n);
+    }
+}
+
+/* Set ARCHIVE for writing, then compressing an archive.  If APPEND,
+   the archive is a local file and the compressor output is appended
+   to it as a new frame.  */
 pid_t
-sys_child_open_for_compress (void)
+sys_child_open_for_compress (bool append)
 {
   int parent_pipe[2];
   int child_pipe[2];
@@ -387,14 +525,17 @@ sys_child_open_for_compress (void)
   if (!_remdev (archive_name_array[0])
       && is_regular_file (archive_name_array[0]))
     {
-      if (backup_option)
+      if (backup_option && !append)
 	maybe_backup_file (archive_name_array[0], 1);
 
       /* We don't need a grandchild tar.  Open the archive and launch the
 	 compressor.  */
       if (!streq (archive_name_array[0], "-"))
 	{
-	  archive = creat (archive_name_array[0], MODE_RW);
+	  archive = (append
+		     ? open (archive_name_array[0],
+			     O_WRONLY | O_APPEND | O_BINARY)
+		     : creat (archive_name_array[0], MODE_RW));
 	  if (archive < 0)
 	    {
 	      int saved_errno = errno;
@@ -407,7 +548,7 @@ sys_child_open_for_compress (void)
 	  xdup2 (archive, STDOUT_FILENO);
 	}
       priv_set_restore_linkdir ();
-      xexec (use_compress_program_option);
+      run_compress_program ();
     }
 
   /* We do need a grandchild tar.  */
@@ -424,7 +565,7 @@ sys_child_open_for_compress (void)
       xdup2 (child_pipe[PWRITE], STDOUT_FILENO);
       xclose (child_pipe[PREAD]);
       priv_set_restore_linkdir ();
-      xexec (use_compress_program_option);
+      run_compress_program ();
     }
 
   /* The child tar is still here!  */
@@ -445,53 +586,31 @@ sys_child_open_for_compress (void)
 
   /* Let's read out of the stdin pipe and write an archive.  */
 
-  while (1)
-    {
-      ptrdiff_t status = 0;
-      char *cursor;
-      idx_t length;
-
-      /* Assemble a record.  */
-
-      for (length = 0, cursor = charptr (record_start);
-	   length < record_size;
-	   length += status, cursor += status)
-	{
-	  idx_t size = record_size - length;
-
-	  status = safe_read (STDIN_FILENO, cursor, size);
-	  if (status < 0)
-	    read_fatal (use_compress_program_option);
-	  if (status == 0)
-	    break;
-	}
-
-      /* Copy the record.  */
-
-      if (status == 0)
-	{
-	  /* We hit the end of the file.  Write last record at
-	     full length, as the only role of the grandchild is
-	     doing proper reblocking.  */
-
-	  if (length > 0)
-	    {
-	      memset (charptr (record_start) + length, 0, record_size - length);
-	      status = sys_write_archive_buffer ();
-	      if (status != record_size)
-		archive_write_error (status);
-	    }
-
-	  /* There is nothing else to read, break out.  */
-	  break;
-	}
+  copy_to_archive (use_compress_program_option);
+  wait_for_grandchild (grandchild_pid);
+}
 
-      status = sys_write_archive_buffer ();
-      if (status != record_size)
-	archive_write_error (status);
+/* Try to execute the decompression program P.  *PPROG is the program
+   tried previously, if any.  Return only if execution failed.  */
+static void
+exec_decompress_program (char const *p, char const **pprog,
+			 struct wordsplit *ws, int *pwsflags)
+{
+  if (*pprog)
+    {
+      warnopt (WARN_DECOMPRESS_PROGRAM, errno, _("cannot run %s"), *pprog);
+      warnopt (WARN_DECOMPRESS_PROGRAM, 0, _("trying %s"), p);
     }
-
-  wait_for_grandchild (grandchild_pid);
+  if (wordsplit (p, ws, *pwsflags) != WRDSE_OK)
+    paxfatal (0, _("cannot split string '%s': %s"),
+	      p, wordsplit_strerror (ws));
+  *pwsflags |= WRDSF_REUSE;
+  memmove (ws->ws_wordv, ws->ws_wordv + ws->ws_offs,
+	   ws->ws_wordc * sizeof *ws->ws_wordv);
+  ws->ws_wordv[ws->ws_wordc] = (char *) "-d";
+  *pprog = p;
+  execvp (ws->ws_wordv[0], ws->ws_wordv);
+  ws->ws_wordv[ws->ws_wordc] = NULL;
 }
 
 static void
@@ -507,30 +626,23 @@ run_decompress_program (void)
 
   for (p = first_decompress_program (&i); p; p = next_decompress_program (&i))
     {
-      if (prog)
-	{
-	  warnopt (WARN_DECOMPRESS_PROGRAM, errno, _("cannot run %s"), prog);
-	  warnopt (WARN_DECOMPRESS_PROGRAM, 0, _("trying %s"), p);
-	}
-      if (wordsplit (p, &ws, wsflags) != WRDSE_OK)
-	paxfatal (0, _("cannot split string '%s': %s"),
-		  p, wordsplit_strerror (&ws));
-      wsflags |= WRDSF_REUSE;
-      memmove (ws.ws_wordv, ws.ws_wordv + ws.ws_offs,
-	       ws.ws_wordc * sizeof *ws.ws_wordv);
-      ws.ws_wordv[ws.ws_wordc] = (char *) "-d";
-      prog = p;
-      execvp (ws.ws_wordv[0], ws.ws_wordv);
-      ws.ws_wordv[ws.ws_wordc] = NULL;
+      /* With --compress-threads, prefer the multi-threaded
+	 counterpart of each candidate.  */
+      char *pp = parallel_compress_program (p, true);
+      if (pp)
+	exec_decompress_program (pp, &prog, &ws, &wsflags);
+      exec_decompress_program (p, &prog, &ws, &wsflags);
     }
   if (!prog)
     paxfatal (0, _("unable to run decompression program"));
   exec_fatal (prog);
 }
 
-/* Set ARCHIVE for uncompressing, then reading an archive.  */
+/* Set ARCHIVE for uncompressing, then reading an archive.  Start
+   reading at byte OFFSET, which must be zero unless the archive is a
+   local regular file.  */
 pid_t
-sys_child_open_for_uncompress (void)
+sys_child_open_for_uncompress (off_t offset)
 {
   int parent_pipe[2];
   int child_pipe[2];
@@ -572,6 +684,11 @@ sys_child_open_for_uncompress (void)
       archive = open (archive_name_array[0], O_RDONLY | O_BINARY, MODE_RW);
       if (archive < 0)
 	open_fatal (archive_name_array[0]);
+      if (offset && lseek (archive, offset, SEEK_SET) < 0)
+	{
+	  seek_error_details (archive_name_array[0], offset);
+	  fatal_exit ();
+	}
       xdup2 (archive, STDIN_FILENO);
       priv_set_restore_linkdir ();
       run_decompress_program ();
@@ -612,31 +729,101 @@ sys_child_open_for_uncompress (void)
 
   /* Let's read the archive and pipe it into stdout.  */
 
-  while (true)
+  copy_from_archive (use_compress_program_option);
+  xclose (STDOUT_FILENO);
+
+  wait_for_grandchild (grandchild_pid);
+}
+
+/* Try to let the pipe FD hold SIZE bytes.  Unprivileged processes
+   may not exceed /proc/sys/fs/pipe-max-size, so clamp SIZE to it, and
+   retry with smaller sizes if the system still refuses.  */
+static void
+set_pipe_size (MAYBE_UNUSED int fd, MAYBE_UNUSED idx_t size)
+{
+#ifdef F_SETPIPE_SZ
+  int n = min (size, INT_MAX);
+  FILE *fp = fopen ("/proc/sys/fs/pipe-max-size", "r");
+  if (fp)
     {
-      clear_read_error_count ();
+      intmax_t max;
+      if (fscanf (fp, "%jd", &max) == 1 && 0 < max && max < n)
+	n = max;
+      fclose (fp);
+    }
 
-      ptrdiff_t n;
-      while ((n = rmtread (archive, charptr (record_start), record_size)) < 0)
-	archive_read_error ();
-      if (n == 0)
-	break;
+  while (fcntl (fd, F_SETPIPE_SZ, n) < 0)
+    {
+      if (! (errno == EPERM || errno == EBUSY) || n <= PIPE_BUF)
+	{
+	  paxwarn (errno, _("Cannot set pipe buffer size to %d bytes"), n);
+	  break;
+	}
+      n /= 2;
+    }
+#endif
+}
 
-      char *cursor = charptr (record_start);
-      do
+/* Set up a child tar that does the actual reading or writing of
+   ARCHIVE, which is open for WANTED_ACCESS, and set ARCHIVE to a pipe
+   to the child instead.  The pipe holds up to SIZE bytes, if the
+   system permits, so that this process does not have to wait for each
+   record to be read or written.  */
+pid_t
+sys_child_open_for_io (enum access_mode wanted_access, idx_t size)
+{
+  bool reading = wanted_access == ACCESS_READ;
+  int parent_pipe[2];
+  pid_t child_pid;
+
+  if (!reading)
+    signal (SIGPIPE, SIG_IGN);
+  xpipe (parent_pipe);
+  set_pipe_size (parent_pipe[PREAD], size);
+  child_pid = xfork ();
+
+  if (child_pid > 0)
+    {
+      /* The parent tar is still here!  Just clean up.  */
+
+      xclose (archive);
+      if (reading)
 	{
-	  idx_t count = min (n, BLOCKSIZE);
-	  if (full_write (STDOUT_FILENO, cursor, count) != count)
-	    write_error (use_compress_program_option);
-	  cursor += count;
-	  n -= count;
+	  archive = parent_pipe[PREAD];
+	  xclose (parent_pipe[PWRITE]);
 	}
-      while (n);
+      else
+	{
+	  archive = parent_pipe[PWRITE];
+	  xclose (parent_pipe[PREAD]);
+	}
+      return child_pid;
     }
 
-  xclose (STDOUT_FILENO);
+  /* The newborn child tar is here!  */
 
-  wait_for_grandchild (grandchild_pid);
+  set_program_name (_("tar (child)"));
+  signal (SIGPIPE, SIG_DFL);
+
+  if (reading)
+    {
+      xdup2 (parent_pipe[PWRITE], STDOUT_FILENO);
+      xclose (parent_pipe[PREAD]);
+      copy_from_archive (archive_name_array[0]);
+      xclose (STDOUT_FILENO);
+    }
+  else
+    {
+      xdup2 (parent_pipe[PREAD], STDIN_FILENO);
+      xclose (parent_pipe[PWRITE]);
+      copy_to_archive (archive_name_array[0]);
+    }
+
+  /* Errors such as delayed write-back failures on network file
+     systems are reported only when the archive is closed.  */
+  if (rmtclose (archive) < 0)
+    close_error (archive_name_array[0]);
+  exit (exit_status);
 }
 
 
@@ -46,8 +46,15 @@ enum backup_type backup_type;
 bool block_number_option;
 intmax_t checkpoint_option;
 const char *use_compress_program_option;
+intmax_t compress_threads_option;
+intmax_t buffer_records_option;
+intmax_t read_ahead_option;
+intmax_t extract_workers_option;
+intmax_t scan_workers_option;
 bool dereference_option;
 bool hard_dereference_option;
+bool deduplicate_option;
+bool digest_option;
 struct exclude *excluded;
 char const *group_name_option;
 gid_t group_option;
@@ -61,6 +68,7 @@ enum old_files old_files_option;
 bool keep_directory_symlink_option;
 const char *listed_incremental_option;
 signed char incremental_level;
+char const *change_journal_option;
 bool check_device_option;
 struct mode_change *mode_option;
 mode_t initial_umask;
@@ -92,6 +100,7 @@ bool sparse_option;
 intmax_t tar_sparse_major;
 intmax_t tar_sparse_minor;
 enum hole_detection_method hole_detection;
+enum stats_format stats_format_option;
 bool starting_file_option;
 tarlong tape_length_option;
 bool to_stdout_option;
@@ -109,6 +118,8 @@ const char **archive_name_array;
 idx_t archive_names;
 const char **archive_name_cursor;
 char const *index_file_name;
+char const *seek_index_option;
+intmax_t frame_size_option;
 int open_read_flags;
 struct open_how open_searchdir_how;
 int fstatat_flags;
@@ -315,6 +326,9 @@ subcommand_string (enum subcommand c)
 
     case TEST_LABEL_SUBCOMMAND:
       return "--test-label";
+
+    case WATCH_CHANGES_SUBCOMMAND:
+      return "--watch-changes";
     }
   abort ();
 }
@@ -356,14 +370,21 @@ enum
   ACLS_OPTION = CHAR_MAX + 1,
   ATIME_PRESERVE_OPTION,
   BACKUP_OPTION,
+  BUFFER_RECORDS_OPTION,
+  CHANGE_JOURNAL_OPTION,
   CHECK_DEVICE_OPTION,
   CHECKPOINT_OPTION,
   CHECKPOINT_ACTION_OPTION,
   CLAMP_MTIME_OPTION,
+  COMPRESS_THREADS_OPTION,
+  DEDUPLICATE_OPTION,
   DELAY_DIRECTORY_RESTORE_OPTION,
   HARD_DEREFERENCE_OPTION,
   DELETE_OPTION,
+  DIGEST_OPTION,
+  EXTRACT_WORKERS_OPTION,
   FORCE_LOCAL_OPTION,
+  FRAME_SIZE_OPTION,
   FULL_TIME_OPTION,
   GROUP_OPTION,
   GROUP_MAP_OPTION,
@@ -404,6 +425,7 @@ enum
   POSIX_OPTION,
   QUOTE_CHARS_OPTION,
   QUOTING_STYLE_OPTION,
+  READ_AHEAD_OPTION,
   RECORD_SIZE_OPTION,
   RECURSIVE_UNLINK_OPTION,
   REMOVE_FILES_OPTION,
@@ -411,6 +433,8 @@ enum
   RMT_COMMAND_OPTION,
   RSH_COMMAND_OPTION,
   SAME_OWNER_OPTION,
+  SCAN_WORKERS_OPTION,
+  SEEK_INDEX_OPTION,
   SELINUX_CONTEXT_OPTION,
   SHOW_DEFAULTS_OPTION,
   SHOW_OMITTED_DIRS_OPTION,
@@ -420,6 +444,7 @@ enum
   SORT_OPTION,
   HOLE_DETECTION_OPTION,
   SPARSE_VERSION_OPTION,
+  STATS_FORMAT_OPTION,
   STRIP_COMPONENTS_OPTION,
   SUFFIX_OPTION,
   TEST_LABEL_OPTION,
@@ -429,6 +454,7 @@ enum
   UTC_OPTION,
   VOLNO_FILE_OPTION,
   WARNING_OPTION,
+  WATCH_CHANGES_OPTION,
   XATTR_OPTION,
   XATTR_EXCLUDE,
   XATTR_INCLUDE,
@@ -552,6 +578,9 @@ static struct argp_option options[] = {
    N_("delete from the archive (not on mag tapes!)"), GRID_COMMAND },
   {"test-label", TEST_LABEL_OPTION, NULL, 0,
    N_("test the archive volume label and exit"), GRID_COMMAND },
+  {"watch-changes", WATCH_CHANGES_OPTION, NULL, 0,
+   N_("record the directories that change in the journal given by"
+      " --change-journal, until killed"), GRID_COMMAND },
 
   {NULL, 0, NULL, 0,
    N_("Operation modifiers:"), GRH_MODIFIER },
@@ -569,8 +598,17 @@ static struct argp_option options[] = {
    N_("handle new GNU-format incremental backup"), GRID_MODIFIER },
   {"level", LEVEL_OPTION, N_("NUMBER"), 0,
    N_("dump level for created listed-incremental archive"), GRID_MODIFIER },
+  {"change-journal", CHANGE_JOURNAL_OPTION, N_("FILE"), 0,
+   N_("when creating a listed-incremental archive, skip the directories"
+      " that the change journal FILE shows to be unchanged"), GRID_MODIFIER },
+  {"scan-workers", SCAN_WORKERS_OPTION, N_("N"), 0,
+   N_("when creating an incremental archive, have N worker processes"
+      " read ahead the directories being scanned"), GRID_MODIFIER },
   {"ignore-failed-read", IGNORE_FAILED_READ_OPTION, NULL, 0,
    N_("do not exit with nonzero on unreadable files"), GRID_MODIFIER },
+  {"read-ahead", READ_AHEAD_OPTION, N_("N"), 0,
+   N_("when creating, have the system read ahead the N files that follow"
+      " the one being archived"), GRID_MODIFIER },
   {"occurrence", OCCURRENCE_OPTION, N_("NUMBER"), OPTION_ARG_OPTIONAL,
    N_("process only the NUMBERth occurrence of each file in the archive;"
       " this option is valid only in conjunction with one of the subcommands"
@@ -581,6 +619,12 @@ static struct argp_option options[] = {
    N_("archive is seekable"), GRID_MODIFIER },
   {"no-seek", NO_SEEK_OPTION, NULL, 0,
    N_("archive is not seekable"), GRID_MODIFIER },
+  {"seek-index", SEEK_INDEX_OPTION, N_("FILE"), 0,
+   N_("when creating, write an index of members to FILE; when reading,"
+      " use it to seek to the requested members"), GRID_MODIFIER },
+  {"digest", DIGEST_OPTION, NULL, 0,
+   N_("when creating, store a digest of the contents of each file;"
+      " when comparing, check files against it"), GRID_MODIFIER },
   {"no-check-device", NO_CHECK_DEVICE_OPTION, NULL, 0,
    N_("do not check device numbers when creating incremental archives"),
    GRID_MODIFIER },
@@ -683,6 +727,9 @@ static struct argp_option options[] = {
       " directories until the end of extraction"), GRID_FATTR },
   {"no-delay-directory-restore", NO_DELAY_DIRECTORY_RESTORE_OPTION, NULL, 0,
    N_("cancel the effect of --delay-directory-restore option"), GRID_FATTR },
+  {"extract-workers", EXTRACT_WORKERS_OPTION, N_("N"), 0,
+   N_("set the status of extracted files in N worker processes"),
+   GRID_FATTR },
   {"sort", SORT_OPTION, N_("ORDER"), 0,
 #if D_INO_IN_DIRENT
    N_("directory sorting order: none (default), name or inode")
@@ -767,6 +814,9 @@ static struct argp_option options[] = {
    N_("ignore zeroed blocks in archive (means EOF)"), GRID_BLOCKING },
   {"read-full-records", 'B', NULL, 0,
    N_("reblock as we read (for 4.2BSD pipes)"), GRID_BLOCKING },
+  {"buffer-records", BUFFER_RECORDS_OPTION, N_("N"), 0,
+   N_("read or write the archive in a separate process, buffering up to"
+      " N records"), GRID_BLOCKING },
 
   {NULL, 0, NULL, 0,
    N_("Archive format selection:"), GRH_FORMAT },
@@ -809,6 +859,12 @@ static struct argp_option options[] = {
    GRID_COMPRESS },
   {"use-compress-program", 'I', N_("PROG"), 0,
    N_("filter through PROG (must accept -d)"), GRID_COMPRESS },
+  {"compress-threads", COMPRESS_THREADS_OPTION, N_("N"), 0,
+   N_("run N (de)compression threads, if the compression program"
+      " supports it; 0 means use all available processors"),
+   GRID_COMPRESS },
+  {"frame-size", FRAME_SIZE_OPTION, N_("SIZE"), 0,
+   N_("restart compression every SIZE bytes of archive"), GRID_COMPRESS },
   /* Note: docstrings for the options below are generated by tar_help_filter */
   {"bzip2", 'j', NULL, 0, NULL, GRID_COMPRESS },
   {"gzip", 'z', NULL, 0, NULL, GRID_COMPRESS },
@@ -834,6 +890,8 @@ static struct argp_option options[] = {
   {"hard-dereference", HARD_DEREFERENCE_OPTION, NULL, 0,
    N_("follow hard links; archive and dump the files they refer to"),
    GRID_FILE },
+  {"deduplicate", DEDUPLICATE_OPTION, NULL, 0,
+   N_("store files with the same contents only once"), GRID_FILE },
   {"starting-file", 'K', N_("MEMBER-NAME"), 0,
    N_("begin at member MEMBER-NAME when reading the archive"),
    GRID_FILE },
@@ -874,6 +932,9 @@ static struct argp_option options[] = {
       "with an argument - print total bytes when this SIGNAL is delivered; "
       "Allowed signals are: SIGHUP, SIGQUIT, SIGINT, SIGUSR1 and SIGUSR2; "
       "the names without SIG prefix are also accepted"), GRID_INFORMATIVE },
+  {"stats-format", STATS_FORMAT_OPTION, N_("FORMAT"), 0,
+   N_("print totals and performance statistics in FORMAT "
+      "('text' or 'json')"), GRID_INFORMATIVE },
   {"utc", UTC_OPTION, NULL, 0,
    N_("print file modification times in UTC"), GRID_INFORMATIVE },
   {"full-time", FULL_TIME_OPTION, NULL, 0,
@@ -1386,6 +1447,18 @@ static enum hole_detection_method const hole_detection_types[] =
 
 ARGMATCH_VERIFY (hole_detection_args, hole_detection_types);
 
+static char const *const stats_format_args[] =
+{
+  "text", "json", NULL
+};
+
+static enum stats_format const stats_format_types[] =
+{
+  STATS_FORMAT_TEXT, STATS_FORMAT_JSON
+};
+
+ARGMATCH_VERIFY (stats_format_args, stats_format_types);
+
 
 static void
 set_old_files_option (enum old_files code, struct option_locus *loc)
@@ -1595,6 +1668,14 @@ parse_opt (int key, char *arg, struct argp_state *state)
       hard_dereference_option = true;
       break;
 
+    case DEDUPLICATE_OPTION:
+      deduplicate_option = true;
+      break;
+
+    case DIGEST_OPTION:
+      digest_option = true;
+      break;
+
     case 'i':
       /* Ignore zero blocks (eofs).  This can't be the default,
 	 because Unix tar writes two blocks of zeros, then pads out
@@ -1803,6 +1884,10 @@ parse_opt (int key, char *arg, struct argp_state *state)
       set_subcommand_option (TEST_LABEL_SUBCOMMAND);
       break;
 
+    case WATCH_CHANGES_OPTION:
+      set_subcommand_option (WATCH_CHANGES_SUBCOMMAND);
+      break;
+
     case TRANSFORM_OPTION:
       set_transform_expr (arg);
       break;
@@ -1868,6 +1953,10 @@ parse_opt (int key, char *arg, struct argp_state *state)
 		       " on this platform"));
       break;
 
+    case CHANGE_JOURNAL_OPTION:
+      change_journal_option = arg;
+      break;
+
     case CHECK_DEVICE_OPTION:
       check_device_option = true;
       break;
@@ -1924,6 +2013,10 @@ parse_opt (int key, char *arg, struct argp_state *state)
       set_archive_format (arg);
       break;
 
+    case SEEK_INDEX_OPTION:
+      seek_index_option = arg;
+      break;
+
     case INDEX_FILE_OPTION:
       index_file_name = arg;
       break;
@@ -2054,6 +2147,36 @@ parse_opt (int key, char *arg, struct argp_state *state)
       set_archive_format ("posix");
       break;
 
+    case EXTRACT_WORKERS_OPTION:
+      {
+	char *end;
+	extract_workers_option = stoint (arg, &end, NULL, 0, IDX_MAX);
+	if (*end)
+	  paxusage ("%s: %s", quotearg_colon (arg),
+		    _("Invalid number of processes"));
+      }
+      break;
+
+    case SCAN_WORKERS_OPTION:
+      {
+	char *end;
+	scan_workers_option = stoint (arg, &end, NULL, 0, IDX_MAX);
+	if (*end)
+	  paxusage ("%s: %s", quotearg_colon (arg),
+		    _("Invalid number of processes"));
+      }
+      break;
+
+    case READ_AHEAD_OPTION:
+      {
+	char *end;
+	read_ahead_option = stoint (arg, &end, NULL, 0, INTMAX_MAX);
+	if (*end)
+	  paxusage ("%s: %s", quotearg_colon (arg),
+		    _("Invalid number of files"));
+      }
+      break;
+
     case RECORD_SIZE_OPTION:
       {
 	uintmax_t u;
@@ -2136,6 +2259,11 @@ parse_opt (int key, char *arg, struct argp_state *state)
       to_command_option = arg;
       break;
 
+    case STATS_FORMAT_OPTION:
+      stats_format_option = XARGMATCH ("--stats-format", arg,
+				       stats_format_args, stats_format_types);
+      break;
+
     case TOTALS_OPTION:
       if (arg)
 	set_stat_signal (arg);
@@ -2147,6 +2275,36 @@ parse_opt (int key, char *arg, struct argp_state *state)
       set_use_compress_program_option (arg, args->loc);
       break;
 
+    case FRAME_SIZE_OPTION:
+      {
+	uintmax_t u;
+	if (! (xstrtoumax (arg, NULL, 10, &u, TAR_SIZE_SUFFIXES) == LONGINT_OK
+	       && u <= INTMAX_MAX))
+	  paxusage ("%s: %s", quotearg_colon (arg), _("Invalid frame size"));
+	frame_size_option = u;
+      }
+      break;
+
+    case BUFFER_RECORDS_OPTION:
+      {
+	char *end;
+	buffer_records_option = stoint (arg, &end, NULL, 0, INTMAX_MAX);
+	if (*end)
+	  paxusage ("%s: %s", quotearg_colon (arg),
+		    _("Invalid number of records"));
+      }
+      break;
+
+    case COMPRESS_THREADS_OPTION:
+      {
+	char *end;
+	compress_threads_option = stoint (arg, &end, NULL, 0, INTMAX_MAX);
+	if (*end)
+	  paxusage ("%s: %s", quotearg_colon (arg),
+		    _("Invalid number of threads"));
+      }
+      break;
+
     case VOLNO_FILE_OPTION:
       volno_file_option = arg;
       break;
@@ -2293,7 +2451,8 @@ static char const subcommand_class[] = {
   [EXTRACT_SUBCOMMAND	] = SUBCL_READ | SUBCL_OCCUR,
   [LIST_SUBCOMMAND	] = SUBCL_READ | SUBCL_OCCUR,
   [UPDATE_SUBCOMMAND	] = SUBCL_WRITE | SUBCL_UPDATE,
-  [TEST_LABEL_SUBCOMMAND] = SUBCL_TEST
+  [TEST_LABEL_SUBCOMMAND] = SUBCL_TEST,
+  [WATCH_CHANGES_SUBCOMMAND] = 0
 };
 
 /* Is subcommand_option in class(es) f?  */
@@ -2373,6 +2532,8 @@ decode_options (int argc, char **argv)
   record_size = DEFAULT_BLOCKING * BLOCKSIZE;
   excluded = new_exclude ();
   hole_detection = HOLE_DETECTION_DEFAULT;
+  compress_threads_option = 1;
+  frame_size_option = -1;
 
   newer_mtime_option.tv_sec = TYPE_MINIMUM (time_t);
   newer_mtime_option.tv_nsec = -1;
@@ -2588,6 +2749,20 @@ decode_options (int argc, char **argv)
 	}
     }
 
+  if (buffer_records_option)
+    {
+      if (multi_volume_option)
+	option_conflict_error ("--buffer-records", "--multi-volume");
+      if (verify_option)
+	option_conflict_error ("--buffer-records", "--verify");
+    }
+
+  if (seek_index_option && multi_volume_option)
+    option_conflict_error ("--seek-index", "--multi-volume");
+
+  if (frame_size_option < 0)
+    frame_size_option = seek_index_option ? DEFAULT_FRAME_SIZE : 0;
+
   if (use_compress_program_option)
     {
       if (multi_volume_option)
@@ -2636,6 +2811,16 @@ decode_options (int argc, char **argv)
       && !is_subcommand_class (SUBCL_READ))
     paxusage (_("--xattrs can be used only on POSIX archives"));
 
+  if (deduplicate_option
+      && archive_format != POSIX_FORMAT
+      && !is_subcommand_class (SUBCL_READ))
+    paxusage (_("--deduplicate can be used only on POSIX archives"));
+
+  if (digest_option
+      && archive_format != POSIX_FORMAT
+      && !is_subcommand_class (SUBCL_READ))
+    paxusage (_("--digest can be used only on POSIX archives"));
+
   if (starting_file_option && !is_subcommand_class (SUBCL_READ))
     {
       if (option_set_in_cl (OC_STARTING_FILE))
@@ -2780,6 +2965,14 @@ decode_options (int argc, char **argv)
 	   archive_name_cursor++)
 	if (streq (*archive_name_cursor, "-"))
 	  paxusage (_("Options '-Aru' are incompatible with '-f -'"));
+      break;
+
+    case WATCH_CHANGES_SUBCOMMAND:
+      if (!change_journal_option)
+	paxusage (_("--watch-changes requires --change-journal"));
+      if (!name_more_files ())
+	paxusage (_("--watch-changes requires a list of directories"));
+      break;
 
     default:
       break;
@@ -2924,6 +3117,10 @@ main (int argc, char **argv)
 
     case TEST_LABEL_SUBCOMMAND:
       test_archive_label ();
+      break;
+
+    case WATCH_CHANGES_SUBCOMMAND:
+      watch_changes ();
     }
 
   checkpoint_finish ();
@@ -2990,6 +3187,7 @@ tar_stat_destroy (struct tar_stat_info *st)
   free (st->acls_d_ptr);
   free (st->sparse_map);
   free (st->dumpdir);
+  free (st->digest);
   xheader_destroy (&st->xhdr);
   info_free_exclist (st);
   memset (st, 0, sizeof (*st));
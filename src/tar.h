@@ -311,6 +311,8 @@ struct tar_stat_info
   bool had_trailing_slash;  /* true if the current archive entry had a
 			       trailing slash before it was normalized. */
   char *link_name;          /* name of link for the current archive entry.  */
+  bool is_duplicate;        /* true if the entry is a link to a file with
+			       the same contents, rather than a hard link */
 
   char          *uname;     /* user name of owner */
   char          *gname;     /* group name of owner */
@@ -363,6 +365,10 @@ struct tar_stat_info
   bool skipped;             /* The member contents are already read.  */
   char *dumpdir;            /* Contents of the dump directory */
 
+  /* SHA-256 digest of the contents of a regular file, as hexadecimal
+     digits, or null if not known.  */
+  char *digest;
+
   /* Parent directory, if creating an archive.  This is null if the
      file is at the top level.  */
   struct tar_stat_info *parent;
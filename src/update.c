@@ -209,6 +209,7 @@ update_archive (void)
   time_to_start_writing = true;
   output_start = charptr (current_block);
 
+  start_read_ahead_workers ();
   {
     struct name const *p;
     while ((p = name_from_list ()) != NULL)
@@ -225,6 +226,7 @@ update_archive (void)
       }
   }
 
+  stop_scan_workers ();
   write_eot ();
   close_archive ();
   finish_deferred_unlinks ();
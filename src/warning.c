@@ -51,6 +51,7 @@ static char const *const warning_args[] = {
   "missing-zero-blocks",
   "verbose",
   "empty-transform",
+  "compress-program",
   NULL
 };
 
@@ -82,7 +83,8 @@ static int warning_types[] = {
   WARN_FAILED_READ,
   WARN_MISSING_ZERO_BLOCKS,
   WARN_VERBOSE_WARNINGS,
-  WARN_EMPTY_TRANSFORM
+  WARN_EMPTY_TRANSFORM,
+  WARN_COMPRESS_PROGRAM
 };
 
 ARGMATCH_VERIFY (warning_args, warning_types);
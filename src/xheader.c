@@ -1492,6 +1492,52 @@ dumpdir_decoder (struct tar_stat_info *st,
    paxerror (0, _("Malformed dumpdir: missing terminator"));
 }
 
+static void
+digest_coder (struct tar_stat_info const *st, char const *keyword,
+	      struct xheader *xhdr, void const *UNNAMED (data))
+{
+  code_string (st->digest, keyword, xhdr);
+}
+
+static void
+digest_decoder (struct tar_stat_info *st,
+		char const *keyword,
+		char const *arg,
+		idx_t size)
+{
+  bool valid = size == DIGEST_HEX_SIZE - 1;
+  for (idx_t i = 0; valid && i < size; i++)
+    valid = c_isxdigit (arg[i]);
+  if (!valid)
+    {
+      paxerror (0, _("Malformed extended header: invalid %s=%s"),
+		keyword, quote (arg));
+      return;
+    }
+  decode_string (&st->digest, arg);
+  for (char *p = st->digest; *p; p++)
+    *p = c_tolower (*p);
+}
+
+static void
+duplicate_coder (struct tar_stat_info const *UNNAMED (st),
+		 char const *keyword,
+		 struct xheader *xhdr, void const *UNNAMED (data))
+{
+  code_num (1, keyword, xhdr);
+}
+
+static void
+duplicate_decoder (struct tar_stat_info *st,
+		   char const *keyword,
+		   char const *arg,
+		   idx_t UNNAMED (size))
+{
+  uintmax_t u;
+  if (decode_num (&u, arg, 1, keyword))
+    st->is_duplicate = u != 0;
+}
+
 static void
 volume_label_coder (struct tar_stat_info const *UNNAMED (st),
 		    char const *keyword,
@@ -1711,6 +1757,15 @@ struct xhdr_tab const xhdr_tab[] = {
   { "GNU.dumpdir",           dumpdir_coder, dumpdir_decoder,
     XHDR_PROTECTED, false },
 
+  /* A hard link member that stands for a file with the same contents
+     as its target, rather than for the same file.  */
+  { "GNU.duplicate",         duplicate_coder, duplicate_decoder,
+    XHDR_PROTECTED, false },
+
+  /* SHA-256 digest of the member contents.  */
+  { "GNU.digest.sha256",     digest_coder, digest_decoder,
+    XHDR_PROTECTED, false },
+
   /* Keeps the tape/volume label. May be present only in the global headers.
      Equivalent to GNUTYPE_VOLHDR.  */
   { "GNU.volume.label", volume_label_coder, volume_label_decoder,